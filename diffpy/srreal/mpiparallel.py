@@ -0,0 +1,102 @@
+#!/usr/bin/env python
+##############################################################################
+#
+# diffpy.srreal     by DANSE Diffraction group
+#                   Simon J. L. Billinge
+#                   (c) 2013 Trustees of the Columbia University
+#                   in the City of New York.  All rights reserved.
+#
+# File coded by:    Pavol Juhas
+#
+# See AUTHORS.txt for a list of people who contributed.
+# See LICENSE.txt for license information.
+#
+##############################################################################
+
+
+"""Evaluation of PairQuantity calculators over all ranks of an MPI job.
+
+This requires srreal_ext built with "scons mpi=True".  The script is
+executed on every rank, for example with "mpirun -np 4 python script.py",
+and every rank configures its own calculator in the same way.  mpiEval
+is then called collectively on all ranks and each rank evaluates its
+share of atom pairs.  The partial values of PDFCalculator and
+DebyePDFCalculator are plain sums, they are added over the ranks
+with MPI_Allreduce of the raw double arrays.  The results of other
+calculators, for example BondCalculator, are not a plain sum of
+values.  Their _getParallelData strings are combined towards the root
+rank along a binomial tree and the total is then broadcast.  In both
+cases every rank gets the complete result.
+"""
+
+
+# exported items
+__all__ = ['mpiAvailable', 'mpiRankSize', 'mpiEval']
+
+import cPickle
+from diffpy.srreal.srreal_ext import _mpiAvailable, _mpiRankSize
+from diffpy.srreal.srreal_ext import _mpiBroadcast, _mpiReduceData
+from diffpy.srreal.srreal_ext import _mpiAllreduceValue
+
+# ----------------------------------------------------------------------------
+
+def mpiAvailable():
+    '''Return True if srreal_ext was built with MPI support.
+    '''
+    return _mpiAvailable()
+
+
+def mpiRankSize():
+    '''Return a tuple of (rank, size) for MPI_COMM_WORLD.
+
+    Initialize MPI if necessary.
+    Raise RuntimeError if srreal_ext was built without MPI.
+    '''
+    return _mpiRankSize()
+
+
+def mpiEval(pqobj, stru=None, root=0):
+    '''Evaluate PairQuantity calculator split among all MPI ranks.
+
+    This is a collective call that must be executed on every rank.
+
+    pqobj    -- PairQuantity calculator with the same configuration
+                on every rank.  It is set up for a partial evaluation
+                of this rank.
+    stru     -- structure to be evaluated, it is significant only
+                at the root rank and it is broadcast to other ranks.
+                Use the last structure of the calculators when None
+                at the root rank.
+    root     -- rank that provides the structure and collects
+                the data strings of the non-additive calculators
+
+    Return the internal value array of pqobj, which has the same
+    content on all ranks.
+    '''
+    from diffpy.srreal.structureadapter import createStructureAdapter
+    rank, size = _mpiRankSize()
+    sdata = ''
+    if rank == root and stru is not None:
+        struadpt = createStructureAdapter(stru)
+        sdata = cPickle.dumps(struadpt, cPickle.HIGHEST_PROTOCOL)
+    sdata = _mpiBroadcast(sdata, root)
+    if sdata and rank != root:
+        struadpt = cPickle.loads(sdata)
+    elif not sdata:
+        struadpt = pqobj.getStructure()
+    pqobj._setupParallelRun(rank, size)
+    pqobj.eval(struadpt)
+    if size == 1:
+        return pqobj.value
+    # sum raw double buffers of the calculators with additive values
+    if hasattr(pqobj, '_mergeParallelValue'):
+        _mpiAllreduceValue(pqobj, finish=True)
+        return pqobj.value
+    # otherwise reduce the parallel data strings and share the total
+    pdata = _mpiReduceData(pqobj, root)
+    pdata = _mpiBroadcast(pdata, root)
+    pqobj.setStructure(struadpt)
+    pqobj._mergeParallelData(pdata, 1)
+    return pqobj.value
+
+# End of file
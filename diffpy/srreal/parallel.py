@@ -22,18 +22,44 @@ into parallel calculators.
 # exported items
 __all__ = ['createParallelCalculator']
 
+import os
 import copy
+import hashlib
 import inspect
+import cPickle
+import collections
 from diffpy.srreal.attributes import Attributes
 
 # ----------------------------------------------------------------------------
 
-def createParallelCalculator(pqobj, ncpu, pmap):
+def createParallelCalculator(pqobj, ncpu, pmap,
+        sharedmemory=False, persistent=False, treereduction=False):
     '''Create a proxy parallel calculator to a PairQuantity instance.
 
     pqobj    -- instance of PairQuantity calculator to be run in parallel
     ncpu     -- number of parallel jobs
     pmap     -- a parallel map function used to submit job to workers
+    sharedmemory -- flag for publishing the calculator with its structure
+                only once in a file in the shared memory directory.
+                The jobs then receive the file name instead of a pickled
+                calculator and every worker process unpickles it once.
+                The workers must run on the same host.
+    persistent -- flag for keeping the calculators resident in the worker
+                processes between evaluations.  Subsequent evaluations
+                send only the changed double attributes and the changed
+                blocks of the structure pickle.  Any other change of
+                the calculator configuration starts over with new
+                resident calculators.  This implies sharedmemory.
+    treereduction -- flag for summing the partial results pairwise
+                in extra parallel jobs, so that the master merges only
+                a single result.  This takes log2(ncpu) rounds of pmap
+                calls and pays off for many jobs with large results.
+                Raw value arrays of PDF calculators are summed in double
+                precision and the jobs receive only the arrays.  Data
+                strings of other calculators are summed by a calculator
+                in the jobs, which is passed the same way as for the
+                evaluation, that is pickled, in the shared segment or
+                resident in the persistent mode.
 
     Return a proxy calculator instance that has the same interface,
     but executes the calculation in parallel split among ncpu jobs.
@@ -49,20 +75,37 @@ def createParallelCalculator(pqobj, ncpu, pmap):
         pqobj    -- the master PairQuantity object to be evaluated in parallel
         ncpu     -- number of parallel jobs
         pmap     -- a parallel map function used to submit job to workers
+        sharedmemory -- flag for passing the calculator to the jobs
+                    in a shared memory segment
+        session  -- master-side state of the calculators resident
+                    in the workers or None when not persistent
+        treereduction -- flag for pairwise summation of partial results
+                    in parallel jobs
         '''
 
-        def __init__(self, pqobj, ncpu, pmap):
+        def __init__(self, pqobj, ncpu, pmap, sharedmemory, persistent,
+                treereduction):
             '''Initialize a parallel proxy to the PairQuantity instance.
 
             pqobj    -- instance of PairQuantity calculator to be run
                         in parallel
             ncpu     -- number of parallel jobs
             pmap     -- a parallel map function used to submit job to workers
+            sharedmemory -- flag for passing the calculator to the jobs
+                        in a shared memory segment
+            persistent -- flag for keeping the calculators resident
+                        in the worker processes
+            treereduction -- flag for pairwise summation of partial
+                        results in parallel jobs
             '''
             # use explicit assignment to avoid setattr forwarding to the pqobj
             object.__setattr__(self, 'pqobj', pqobj)
             object.__setattr__(self, 'ncpu', ncpu)
             object.__setattr__(self, 'pmap', pmap)
+            object.__setattr__(self, 'sharedmemory', sharedmemory)
+            session = _PersistentSession() if persistent else None
+            object.__setattr__(self, 'session', session)
+            object.__setattr__(self, 'treereduction', treereduction)
             return
 
 
@@ -81,15 +124,37 @@ def createParallelCalculator(pqobj, ncpu, pmap):
                 struadpt = self.pqobj.getStructure()
             else:
                 struadpt = createStructureAdapter(stru)
+            if self.session is not None:
+                return self.session.eval(self.pqobj, struadpt,
+                        self.ncpu, self.pmap, self.treereduction)
             self.pqobj.setStructure(struadpt)
             kwd = { 'cpuindex' : None,
                     'ncpu' : self.ncpu,
                     'pqobj' : copy.copy(self.pqobj),
+                    'rawvalue' : _hasParallelValue(self.pqobj),
                     }
-            # shallow copies of kwd dictionary each with a unique cpuindex
-            arglist = [kwd.copy() for kwd['cpuindex'] in range(self.ncpu)]
-            for pdata in self.pmap(_parallelData, arglist):
-                self.pqobj._mergeParallelData(pdata, self.ncpu)
+            segment = None
+            try:
+                if self.sharedmemory:
+                    pdata = cPickle.dumps(kwd.pop('pqobj'),
+                            cPickle.HIGHEST_PROTOCOL)
+                    segment = _SharedSegment(pdata)
+                    kwd['segment'] = segment.name
+                    del pdata
+                # shallow copies of kwd dictionary with a unique cpuindex
+                arglist = [kwd.copy() for kwd['cpuindex'] in range(self.ncpu)]
+                results = self.pmap(_parallelData, arglist)
+                nmerged = self.ncpu
+                if self.treereduction:
+                    source = dict((n, kwd[n]) for n in ('pqobj', 'segment')
+                            if n in kwd)
+                    results = _reduceResults(results, self.pmap,
+                            kwd['rawvalue'], source)
+                    nmerged = 1
+                _mergeResults(self.pqobj, results, nmerged, kwd['rawvalue'])
+            finally:
+                if segment is not None:
+                    segment.unlink()
             return self.pqobj.value
 
 
@@ -160,15 +225,408 @@ def createParallelCalculator(pqobj, ncpu, pmap):
         setattr(ParallelPairQuantity, n, _make_proxyproperty(p))
 
     # finally create an instance of this very custom class
-    return ParallelPairQuantity(pqobj, ncpu, pmap)
+    return ParallelPairQuantity(pqobj, ncpu, pmap,
+            sharedmemory, persistent, treereduction)
+
+
+def _hasParallelValue(pqobj):
+    '''True if pqobj can transfer parallel results as raw value arrays.
+    '''
+    return hasattr(pqobj, '_mergeParallelValue')
+
+
+def _mergeResults(pqobj, results, ncpu, rawvalue):
+    '''Merge partial results from ncpu parallel jobs to pqobj.
+    '''
+    for i, pdata in enumerate(results):
+        if rawvalue:
+            finish = (i + 1 == ncpu)
+            pqobj._mergeParallelValue(pdata, finish)
+        else:
+            pqobj._mergeParallelData(pdata, ncpu)
+    return
+
+
+def _reduceResults(results, pmap, rawvalue, source):
+    '''Sum partial results pairwise in parallel jobs until one is left.
+
+    results  -- sequence of partial results from the parallel jobs
+    pmap     -- a parallel map function used to submit job to workers
+    rawvalue -- flag for results from _getParallelValue, these are
+                summed in double precision by _reduceParallelValue.
+                Otherwise the results are data strings summed with
+                the _reduceParallelData method.
+    source   -- dictionary that gives the calculator for summing
+                the data strings, either as 'pqobj', as the shared
+                'segment' name or as the persistent 'session' with
+                its 'structure' segments and changed 'attributes'.
+                Not used for raw values.
+
+    Return a list with a single result.
+    '''
+    results = list(results)
+    while len(results) > 1:
+        pairs = [results[i:i + 2] for i in range(0, len(results), 2)]
+        # pass the odd last result to the next round unchanged
+        tail = pairs.pop() if len(pairs[-1]) == 1 else []
+        arglist = []
+        for p in pairs:
+            kwd = {'pdatalist' : p, 'rawvalue' : rawvalue}
+            if not rawvalue:
+                kwd.update(source)
+            arglist.append(kwd)
+        results = list(pmap(_reducedData, arglist)) + tail
+    return results
+
+
+def _reducedData(kwd):
+    '''Helper for summing partial results in a worker node.
+    '''
+    pdatalist = kwd['pdatalist']
+    if kwd['rawvalue']:
+        from diffpy.srreal.pdfcalculator import PDFCalculator
+        return PDFCalculator._reduceParallelValue(pdatalist)
+    if 'segment' in kwd:
+        pqobj = _SharedSegment.attach(kwd['segment'])
+    elif 'session' in kwd:
+        pqobj = _SharedSegment.load(kwd['session'])
+        for n, v in kwd['attributes'].items():
+            pqobj._setDoubleAttr(n, v)
+        pqobj.setStructure(_loadStructure(*kwd['structure']))
+    else:
+        pqobj = kwd['pqobj']
+    return pqobj._reduceParallelData(pdatalist)
 
 
 def _parallelData(kwd):
     '''Helper for calculating and fetching raw results from a worker node.
     '''
-    pqobj = kwd['pqobj']
+    if 'segment' in kwd:
+        pqobj = _SharedSegment.attach(kwd['segment'])
+    else:
+        pqobj = kwd['pqobj']
     pqobj._setupParallelRun(kwd['cpuindex'], kwd['ncpu'])
     pqobj.eval()
+    if kwd.get('rawvalue'):
+        return pqobj._getParallelValue()
     return pqobj._getParallelData()
 
+
+# calculators resident in this process keyed by (session, cpuindex, ncpu)
+# ordered from the least recently used
+_resident = collections.OrderedDict()
+_residentlimit = 16
+
+# the last structure base loaded in this process as (name, data string)
+_structurebase = [None, None]
+
+def _persistentData(kwd):
+    '''Helper for evaluating a calculator resident in a worker node.
+    '''
+    session = kwd['session']
+    key = (session, kwd['cpuindex'], kwd['ncpu'])
+    entry = _resident.pop(key, None)
+    if entry is None:
+        pqobj = _SharedSegment.load(session)
+        pqobj._setupParallelRun(kwd['cpuindex'], kwd['ncpu'])
+        names = pqobj._namesOfWritableDoubleAttributes()
+        baseattrs = dict((n, pqobj._getDoubleAttr(n)) for n in names)
+        entry = { 'pqobj' : pqobj,
+                  'baseattrs' : baseattrs,
+                  'attributes' : {},
+                  'structure' : None,
+                  }
+    _resident[key] = entry
+    while len(_resident) > _residentlimit:
+        _resident.popitem(last=False)
+    pqobj = entry['pqobj']
+    # attributes are sent as changes from the session calculator, revert
+    # those that were changed in the previous call only
+    attrs = kwd['attributes']
+    for n in set(attrs).union(entry['attributes']):
+        pqobj._setDoubleAttr(n, attrs.get(n, entry['baseattrs'][n]))
+    entry['attributes'] = attrs
+    if entry['structure'] != kwd['structure']:
+        stru = _loadStructure(*kwd['structure'])
+        entry['structure'] = kwd['structure']
+        pqobj.eval(stru)
+    else:
+        pqobj.eval()
+    if kwd['rawvalue']:
+        return pqobj._getParallelValue()
+    return pqobj._getParallelData()
+
+
+def _loadStructure(basename, deltaname):
+    '''Return structure adapter from the base and delta segments.
+    '''
+    if _structurebase[0] != basename:
+        _structurebase[:] = [basename, _SharedSegment.read(basename)]
+    data = _structurebase[1]
+    delta = _SharedSegment.load(deltaname)
+    if delta:
+        data = bytearray(data)
+        for offset, block in delta:
+            data[offset:offset + len(block)] = block
+        data = str(data)
+    return cPickle.loads(data)
+
+
+class _PersistentSession(object):
+
+    '''Master-side state of the calculators kept resident in workers.
+
+    The session calculator without structure is published in a shared
+    memory segment.  A change of calculator configuration other than
+    its writable double attributes starts a new session.  The master
+    checks the configuration only when the calculator ticker or its
+    instance dictionary has changed since the last call.
+
+    The structure pickle is published as a base segment and a delta
+    segment with the blocks that differ from the base.  The workers
+    keep the base and read only the delta for a changed structure.
+    The base is replaced when the structure pickle changes its size
+    or when the delta exceeds half of it.
+
+    Instance data:
+
+    base     -- segment with the session calculator or None
+    baseconfig -- pickle of the session calculator for detecting changes
+    baseattrs  -- writable double attributes of the session calculator
+    version  -- ticker and instance dictionary pickle of the calculator
+                at the last configuration check
+    structurebase -- segment with the base structure pickle
+    structuredata -- the base structure pickle string
+    structuredelta -- segment with the changed blocks of the base
+    '''
+
+    _blocksize = 1 << 16
+
+    def __init__(self):
+        self.base = None
+        self.baseconfig = None
+        self.baseattrs = None
+        self.version = None
+        self.structurebase = None
+        self.structuredata = None
+        self.structuredelta = None
+        return
+
+
+    def __del__(self):
+        self.close()
+        return
+
+
+    def eval(self, pqobj, struadpt, ncpu, pmap, treereduction=False):
+        '''Evaluate pqobj for struadpt using the resident calculators.
+
+        Return the internal value array of pqobj.
+        '''
+        from diffpy.srreal.structureadapter import _emptyStructureAdapter
+        names = pqobj._namesOfWritableDoubleAttributes()
+        attrs = dict((n, pqobj._getDoubleAttr(n)) for n in names)
+        pqobj.setStructure(_emptyStructureAdapter())
+        if self._version(pqobj) != self.version:
+            if not self._sameConfiguration(pqobj, attrs):
+                self.close()
+                self.baseconfig = cPickle.dumps(pqobj,
+                        cPickle.HIGHEST_PROTOCOL)
+                self.baseattrs = attrs
+                self.base = _SharedSegment(self.baseconfig)
+            self.version = self._version(pqobj)
+        self._updateStructure(struadpt)
+        pqobj.setStructure(struadpt)
+        rawvalue = _hasParallelValue(pqobj)
+        changed = dict((n, v) for n, v in attrs.items()
+                if v != self.baseattrs[n])
+        kwd = { 'cpuindex' : None,
+                'ncpu' : ncpu,
+                'session' : self.base.name,
+                'structure' : (self.structurebase.name,
+                    self.structuredelta.name),
+                'attributes' : changed,
+                'rawvalue' : rawvalue,
+                }
+        arglist = [kwd.copy() for kwd['cpuindex'] in range(ncpu)]
+        results = pmap(_persistentData, arglist)
+        nmerged = ncpu
+        if treereduction:
+            source = dict((n, kwd[n])
+                    for n in ('session', 'structure', 'attributes'))
+            results = _reduceResults(results, pmap, rawvalue, source)
+            nmerged = 1
+        _mergeResults(pqobj, results, nmerged, rawvalue)
+        return pqobj.value
+
+
+    def close(self):
+        '''Remove the shared memory segments of this session.
+        '''
+        segments = (self.base, self.structurebase, self.structuredelta)
+        for seg in segments:
+            if seg is not None:
+                seg.unlink()
+        self.base = self.structurebase = self.structuredelta = None
+        self.baseconfig = self.baseattrs = self.version = None
+        self.structuredata = None
+        return
+
+
+    def _version(self, pqobj):
+        '''Return ticker and instance dictionary pickle of pqobj.
+        These change with any configuration change of pqobj.
+        '''
+        from diffpy.srreal.eventticker import EventTicker
+        tc = EventTicker(pqobj.ticker())
+        d = cPickle.dumps(pqobj.__dict__, cPickle.HIGHEST_PROTOCOL)
+        return (tc, d)
+
+
+    def _sameConfiguration(self, pqobj, attrs):
+        '''Check if pqobj differs from the session calculator only
+        in the writable double attributes.  pqobj keeps its attributes.
+        '''
+        if self.base is None or set(attrs) != set(self.baseattrs):
+            return False
+        try:
+            for n, v in self.baseattrs.items():
+                pqobj._setDoubleAttr(n, v)
+            config = cPickle.dumps(pqobj, cPickle.HIGHEST_PROTOCOL)
+        finally:
+            for n, v in attrs.items():
+                pqobj._setDoubleAttr(n, v)
+        return config == self.baseconfig
+
+
+    def _updateStructure(self, struadpt):
+        '''Publish the structure segments for struadpt when changed.
+        '''
+        sdata = cPickle.dumps(struadpt, cPickle.HIGHEST_PROTOCOL)
+        base = self.structuredata
+        bsz = self._blocksize
+        delta = None
+        if base is not None and len(base) == len(sdata):
+            delta = [(i, sdata[i:i + bsz])
+                    for i in range(0, len(sdata), bsz)
+                    if sdata[i:i + bsz] != base[i:i + bsz]]
+            if 2 * bsz * len(delta) > len(sdata):
+                delta = None
+        if delta is None:
+            for seg in (self.structurebase, self.structuredelta):
+                if seg is not None:
+                    seg.unlink()
+            self.structuredelta = None
+            self.structurebase = _SharedSegment(sdata)
+            self.structuredata = sdata
+            delta = []
+        ddata = cPickle.dumps(delta, cPickle.HIGHEST_PROTOCOL)
+        del sdata, delta
+        seg = self.structuredelta
+        if seg is not None and seg.digest(seg.name) == \
+                hashlib.sha1(ddata).hexdigest():
+            return
+        if seg is not None:
+            seg.unlink()
+        self.structuredelta = _SharedSegment(ddata)
+        return
+
+# End of class _PersistentSession
+
+
+class _SharedSegment(object):
+
+    '''Pickled data published once in a named broadcast file.
+
+    The segment is a file in the /dev/shm directory, which is the POSIX
+    shared memory on Linux, or in the temporary directory elsewhere.
+    It is not a shared mapping, every worker process reads and unpickles
+    its own copy of the object.  The pickle is thus written once instead
+    of being sent with every job.  The segment name contains the SHA1
+    digest of its content.  Worker processes attach to it by name and
+    keep the last unpickled object keyed by this digest, so that repeated
+    jobs with the same content load it once and a reused file name cannot
+    return a stale object.
+
+    Instance data:
+
+    name     -- name of the segment that identifies it to the workers
+    '''
+
+    _attached = {}
+
+    def __init__(self, pdata):
+        '''Publish pickle string pdata in a new shared memory segment.
+        '''
+        import tempfile
+        prefix = 'srreal-%s-' % hashlib.sha1(pdata).hexdigest()
+        fd, path = tempfile.mkstemp(prefix=prefix, dir=self._directory())
+        try:
+            with os.fdopen(fd, 'wb') as fp:
+                fp.write(pdata)
+        except:
+            os.remove(path)
+            raise
+        self.name = os.path.basename(path)
+        return
+
+
+    def unlink(self):
+        '''Remove this segment.  Attached workers keep their copies.
+        '''
+        os.remove(os.path.join(self._directory(), self.name))
+        return
+
+
+    @staticmethod
+    def digest(name):
+        '''Return the content digest part of the segment name.
+        '''
+        return name.split('-')[1]
+
+
+    @classmethod
+    def attach(cls, name):
+        '''Return a copy of object published in the named segment.
+
+        The object is unpickled once per process and every call returns
+        its fresh copy, so that the jobs of one worker do not share
+        the evaluation state of a calculator.
+        '''
+        key = cls.digest(name)
+        obj = cls._attached.get(key)
+        if obj is None:
+            obj = cls.load(name)
+            cls._attached.clear()
+            cls._attached[key] = obj
+        rv = obj.copy() if hasattr(obj, 'copy') else copy.copy(obj)
+        return rv
+
+
+    @classmethod
+    def load(cls, name):
+        '''Return a new copy of object published in the named segment.
+        '''
+        return cPickle.loads(cls.read(name))
+
+
+    @classmethod
+    def read(cls, name):
+        '''Return the data string published in the named segment.
+        '''
+        path = os.path.join(cls._directory(), name)
+        with open(path, 'rb') as fp:
+            rv = fp.read()
+        return rv
+
+
+    @staticmethod
+    def _directory():
+        import tempfile
+        shmdir = '/dev/shm'
+        rv = shmdir if os.path.isdir(shmdir) else tempfile.gettempdir()
+        return rv
+
+# End of class _SharedSegment
+
 # End of file
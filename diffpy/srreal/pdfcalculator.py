@@ -41,12 +41,12 @@ __all__ = '''DebyePDFCalculator PDFCalculator
     SphericalShapeEnvelope StepCutEnvelope
     PeakProfile
     PeakWidthModel ConstantPeakWidth DebyeWallerPeakWidth JeongPeakWidth
-    fftftog fftgtof
+    fftftog fftgtof SineTransform
     '''.split()
 
 from diffpy.srreal.srreal_ext import DebyePDFCalculator
 from diffpy.srreal.srreal_ext import PDFCalculator
-from diffpy.srreal.srreal_ext import fftftog, fftgtof
+from diffpy.srreal.srreal_ext import fftftog, fftgtof, SineTransform
 from diffpy.srreal.srreal_ext import PDFBaseline, ZeroBaseline, LinearBaseline
 from diffpy.srreal.srreal_ext import PDFEnvelope
 from diffpy.srreal.srreal_ext import ScaleEnvelope, QResolutionEnvelope
@@ -114,6 +114,22 @@ def _defineCommonInterface(cls):
         multiples of rstep.
         [0.01 A]''')
 
+    def _get_singleprecision(self):
+        return self.__dict__.get('_singleprecision', False)
+
+    def _set_singleprecision(self, value):
+        self.__dict__['_singleprecision'] = bool(value)
+        return
+
+    cls.singleprecision = property(
+        _get_singleprecision, _set_singleprecision,
+        doc="""Flag for single precision results and partial data.
+        When set, the value, pdf, rdf and fq arrays and the results of
+        eval are float32 arrays, _getParallelData transfers float32
+        values and evalHistogram keeps its cached sums in float32.
+        The partial values are still summed in double precision.
+        [False]""")
+
     def _call_kwargs(self, structure=None, **kwargs):
         '''Calculate PDF for the given structure as an (r, G) tuple.
         Keyword arguments can be used to configure calculator attributes,
@@ -137,6 +153,88 @@ def _defineCommonInterface(cls):
         return rv
     cls.__call__ = _call_kwargs
 
+    def _sweep(self, structure=None, **gridarrays):
+        '''Calculate PDFs for a grid of calculator attribute values.
+        The structure is converted and expanded only once.  Attributes
+        of the used envelopes and baseline are applied to the already
+        summed PDF.  The distinct combinations of the remaining
+        attributes, for example delta2 or qbroad of the peak width model,
+        are evaluated by calculator copies that share a single sweep
+        over the atom pairs.
+
+        structure    -- a structure object to be evaluated.  Reuse the last
+                        structure when None.
+        gridarrays   -- sequences of values for the swept double attributes.
+                        The swept attributes must not change the r-grid.
+
+        Example:    pdfcalc.sweep(structure, qdamp=[0, 0.01, 0.02],
+                                  delta2=numpy.linspace(0, 5, 11))
+
+        Return a 2D numpy array of PDFs.  The rows follow the C-order
+        of a grid spanned by attribute names sorted alphabetically, i.e.,
+        the last name in the sorted list varies fastest.  The attributes
+        of this calculator are not changed.
+        Raise ValueError for invalid attribute name or for sweep that
+        changes the r-grid.
+        '''
+        import numpy
+        import itertools
+        names = sorted(gridarrays)
+        for n in names:
+            if not self._hasDoubleAttr(n):
+                emsg = "Invalid attribute name %r" % n
+                raise ValueError(emsg)
+        values = [numpy.array(gridarrays[n], dtype=float).flatten()
+                for n in names]
+        gridshape = tuple(len(v) for v in values)
+        if structure is not None:
+            self.setStructure(structure)
+        # check the r-grid before any evaluation
+        rgrid = self.rgrid
+        irgrid = [i for i, n in enumerate(names)
+                if n in ('rmin', 'rmax', 'rstep')]
+        saved = [(n, self._getDoubleAttr(n)) for n in names]
+        try:
+            for rvals in itertools.product(*[values[i] for i in irgrid]):
+                for i, v in zip(irgrid, rvals):
+                    self._setDoubleAttr(names[i], v)
+                if not numpy.array_equal(rgrid, self.rgrid):
+                    emsg = "Swept attributes must not change the r-grid."
+                    raise ValueError(emsg)
+        finally:
+            for n, v in saved:
+                self._setDoubleAttr(n, v)
+        # attributes that are applied to the summed PDF
+        postnames = set()
+        for e in self.envelopes:
+            postnames.update(e._namesOfDoubleAttributes())
+        if hasattr(self, 'baseline'):
+            postnames.update(self.baseline._namesOfDoubleAttributes())
+        iouter = [i for i, n in enumerate(names) if n not in postnames]
+        iinner = [i for i, n in enumerate(names) if n in postnames]
+        outeridx = list(itertools.product(
+            *[range(gridshape[i]) for i in iouter]))
+        calcs = []
+        for oidx in outeridx:
+            pc = self.copy()
+            for i, k in zip(iouter, oidx):
+                pc._setDoubleAttr(names[i], values[i][k])
+            calcs.append(pc)
+        self._sweepPairs(calcs)
+        rv = numpy.empty((int(numpy.prod(gridshape)), len(rgrid)))
+        for pc, oidx in zip(calcs, outeridx):
+            for iidx in itertools.product(
+                    *[range(gridshape[i]) for i in iinner]):
+                for i, k in zip(iinner, iidx):
+                    pc._setDoubleAttr(names[i], values[i][k])
+                gidx = [0] * len(names)
+                for i, k in zip(iouter + iinner, oidx + iidx):
+                    gidx[i] = k
+                irow = numpy.ravel_multi_index(gidx, gridshape) if names else 0
+                rv[irow] = pc.pdf
+        return rv
+    cls.sweep = _sweep
+
 # _defineCommonInterface
 
 # class DebyePDFCalculator ---------------------------------------------------
@@ -168,6 +266,33 @@ DebyePDFCalculator.qstep = propertyFromExtDoubleAttr('qstep',
         [PI/extendedrmax A] unless user overridden.
         See also setOptimumQstep, isOptimumQstep.''')
 
+# Python-level setting for the DebyePDFCalculator.evalHistogram method
+
+def _get_histogramkernel(self):
+    return self.__dict__.get('_histogramkernel', 'recurrence')
+
+def _set_histogramkernel(self, value):
+    if value not in ('simd', 'recurrence', 'direct'):
+        emsg = "histogramkernel must be 'simd', 'recurrence' or 'direct'."
+        raise ValueError(emsg)
+    self.__dict__['_histogramkernel'] = value
+    return
+
+DebyePDFCalculator.histogramkernel = property(
+        _get_histogramkernel, _set_histogramkernel,
+        doc="""Method for evaluating sine terms in evalHistogram.
+        'simd'       -- the recurrence evaluated for 4 histogram cells
+                        at once in vector registers, using AVX2 when
+                        supported by the CPU.
+        'recurrence' -- trigonometric recurrence evaluated in Q-blocks,
+                        which run in parallel when built with OpenMP.
+        'direct'     -- scalar reference that calls sin and exp for
+                        every Q-point.
+        All methods except 'direct' split the Q-grid to blocks that
+        run in parallel when built with OpenMP.  These kernels apply
+        only to evalHistogram, the exact eval uses scalar summation.
+        ['recurrence']""")
+
 # method overrides to support optional keyword arguments
 
 def _init_kwargs0(self, **kwargs):
@@ -186,6 +311,21 @@ def _init_kwargs0(self, **kwargs):
 DebyePDFCalculator.__boostpython__init = DebyePDFCalculator.__init__
 DebyePDFCalculator.__init__ = _init_kwargs0
 
+# pair mask changes invalidate the cached sums of evalHistogram
+
+def _dropHistogramCache(f):
+    def fwrap(self, *args, **kwargs):
+        self.__dict__.pop('_debyehistogramcache', None)
+        return f(self, *args, **kwargs)
+    fwrap.__name__ = f.__name__
+    fwrap.__doc__ = f.__doc__
+    return fwrap
+
+for _n in ('maskAllPairs', 'invertMask', 'setPairMask', 'setTypeMask'):
+    setattr(DebyePDFCalculator, _n,
+            _dropHistogramCache(getattr(DebyePDFCalculator, _n)))
+del _n
+
 # End of class DebyePDFCalculator
 
 # PDFCalculator --------------------------------------------------------------
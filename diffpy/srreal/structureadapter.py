@@ -24,6 +24,11 @@ nometa       -- create StructureAdapter with disabled _customPQConfig method
                 this prevents copying of diffpy.Structure pdffit metadata
                 to PDFCalculator object
 nosymmetry   -- create StructureAdapter with disabled symmetry expansion.
+loadXYZ      -- fast C++ loader of XYZ and extended XYZ files, which returns
+                non-periodic XYZStructureAdapter
+atomTypeId   -- integer ID of an atom type symbol, the same IDs are
+                returned by the StructureAdapter.siteTypeId method
+atomTypeOfId -- atom type symbol of an integer ID
 
 Constants:
 
@@ -33,7 +38,9 @@ EMPTY        -- singleton instance of an empty structure.
 
 from diffpy.srreal.srreal_ext import StructureAdapter, createStructureAdapter
 from diffpy.srreal.srreal_ext import nometa, nosymmetry
+from diffpy.srreal.srreal_ext import XYZStructureAdapter, loadXYZ
 from diffpy.srreal.srreal_ext import _emptyStructureAdapter
+from diffpy.srreal.srreal_ext import atomTypeId, atomTypeOfId
 
 EMPTY = _emptyStructureAdapter()
 
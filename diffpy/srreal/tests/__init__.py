@@ -30,6 +30,7 @@ def testsuite():
         diffpy.srreal.tests.testbondcalculator
         diffpy.srreal.tests.testbvscalculator
         diffpy.srreal.tests.testdebyepdfcalculator
+        diffpy.srreal.tests.testmpiparallel
         diffpy.srreal.tests.testoverlapcalculator
         diffpy.srreal.tests.testpairquantity
         diffpy.srreal.tests.testparallel
@@ -39,6 +40,7 @@ def testsuite():
         diffpy.srreal.tests.testpdfenvelope
         diffpy.srreal.tests.testscatteringfactortable
         diffpy.srreal.tests.teststructureadapter
+        diffpy.srreal.tests.testtrajectory
     '''.split()
     suite = unittest.TestSuite()
     loader = unittest.defaultTestLoader
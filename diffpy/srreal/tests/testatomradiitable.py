@@ -77,6 +77,25 @@ class TestAtomRadiiTable(unittest.TestCase):
         self.assertEqual(1.23, self.rtb.lookup('C'))
         return
 
+    def test_lookupId(self):
+        """check AtomRadiiTable.lookupId()
+        """
+        from diffpy.srreal.structureadapter import atomTypeId
+        self.rtb.setCustom('C', 1.23)
+        self.assertEqual(1.23, self.rtb.lookupId(atomTypeId('C')))
+        # cached radii are discarded after a change of the table
+        self.rtb.setCustom('C', 1.5)
+        self.assertEqual(1.5, self.rtb.lookupId(atomTypeId('C')))
+        self.assertEqual(0, self.ctb.lookupId(atomTypeId('C')))
+        self.ctb.setDefault(2)
+        self.assertEqual(2, self.ctb.lookupId(atomTypeId('C')))
+        self.ctb.setCustom('C', 1.23)
+        self.assertEqual(1.23, self.ctb.lookupId(atomTypeId('C')))
+        self.ctb.resetAll()
+        self.assertEqual(2, self.ctb.lookupId(atomTypeId('C')))
+        self.assertRaises(ValueError, self.ctb.lookupId, -1)
+        return
+
     def test_resetCustom(self):
         """check AtomRadiiTable.resetCustom()
         """
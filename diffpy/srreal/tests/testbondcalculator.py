@@ -238,6 +238,14 @@ class TestBondCalculator(unittest.TestCase):
         bdc()
         tps = set(zip(bdc.types0, bdc.types1))
         self.assertEqual(set([('O', 'O')]), tps)
+        # integer type IDs
+        from diffpy.srreal.structureadapter import atomTypeId
+        tid, oid = atomTypeId('Ti'), atomTypeId('O')
+        bdc.setTypeMask(tid, [oid, 'Ti'], False, others=True)
+        bdc()
+        tps = set(zip(bdc.types0, bdc.types1))
+        self.assertEqual(set([('O', 'O')]), tps)
+        self.assertRaises(ValueError, bdc.setTypeMask, -1, oid, False)
         return
 
 
@@ -163,6 +163,51 @@ class TestBVSCalculator(unittest.TestCase):
         self.assertEqual(8, bpab.B)
         return
 
+
+    def test_copy(self):
+        '''check table mutators of a copy do not change the source.
+        '''
+        bvc = self.bvc
+        bvc.bvparamtable.setCustom('A', 1, 'B', -2, 7, 8)
+        bvc.eval(self.rutile)
+        bpab = bvc.bvparamtable.lookup('A+', 'B2-')
+        bptio = bvc.bvparamtable.lookup('Ti4+', 'O2-')
+        mutators = [
+            lambda t: t.setCustom('A', 1, 'B', -2, 3, 4),
+            lambda t: t.setCustom(t.lookup('Ti4+', 'O2-')),
+            lambda t: t.resetCustom('A', 1, 'B', -2),
+            lambda t: t.resetCustom(bpab),
+            lambda t: t.resetAll(),
+        ]
+        for f in mutators:
+            bvc1 = bvc.copy()
+            self.failUnless(list(bvc.value) == list(bvc1.value))
+            f(bvc1.bvparamtable)
+            bp = bvc.bvparamtable.lookup('A+', 'B2-')
+            self.assertEqual((7, 8), (bp.Ro, bp.B))
+            bp = bvc.bvparamtable.lookup('Ti4+', 'O2-')
+            self.assertEqual((bptio.Ro, bptio.B), (bp.Ro, bp.B))
+        return
+
+
+    def test_lookupId(self):
+        '''check BVParametersTable.lookupId with cached parameters.
+        '''
+        from diffpy.srreal.structureadapter import atomTypeId
+        bvtb = self.bvc.bvparamtable
+        ida, idb = atomTypeId('A+'), atomTypeId('B2-')
+        self.assertEqual(bvtb.none(), bvtb.lookupId(ida, idb))
+        bvtb.setCustom('A', 1, 'B', -2, 7, 8)
+        bp = bvtb.lookupId(idb, ida)
+        self.assertEqual((7, 8), (bp.Ro, bp.B))
+        self.assertEqual(bp, bvtb.lookupId(ida, idb))
+        self.bvc.bvparamtable.resetCustom('A', 1, 'B', -2)
+        self.assertEqual(bvtb.none(), bvtb.lookupId(ida, idb))
+        tid, oid = atomTypeId('Ti4+'), atomTypeId('O2-')
+        self.assertEqual(bvtb.lookup('Ti4+', 'O2-'), bvtb.lookupId(tid, oid))
+        self.assertRaises(ValueError, bvtb.lookupId, -1, oid)
+        return
+
 # End of class TestBVSCalculator
 
 if __name__ == '__main__':
@@ -101,6 +101,91 @@ class TestDebyePDFCalculator(unittest.TestCase):
         self.failUnless(mxnd < 0.0006)
         return
 
+    def test_evalHistogram(self):
+        """check DebyePDFCalculator.evalHistogram()
+        """
+        dpdfc = self.dpdfc
+        r0, g0 = dpdfc(self.bucky)
+        dpdfc.evalHistogram(binwidth=1e-4)
+        g1 = dpdfc.pdf
+        self.failUnless(_maxNormDiff(g0, g1) < 1e-4)
+        dpdfc.evalHistogram(self.bucky, binwidth=0.01)
+        g2 = dpdfc.pdf
+        self.failUnless(_maxNormDiff(g0, g2) < 0.01)
+        self.assertRaises(ValueError, dpdfc.evalHistogram, binwidth=0)
+        self.assertRaises(ValueError, dpdfc.evalHistogram, msdstep=-1)
+        return
+
+    def test_evalHistogram_cache(self):
+        """check reuse of cached histogram sums after sf change.
+        """
+        dpdfc = self.dpdfc
+        dpdfc.qmin = 1
+        rutile = self.tio2rutile
+        gx = dpdfc.evalHistogram(rutile)
+        dpdfc.setScatteringFactorTableByType('N')
+        gn = dpdfc.evalHistogram()
+        dpdfc1 = DebyePDFCalculator(qmin=1)
+        dpdfc1.setScatteringFactorTableByType('N')
+        gn1 = dpdfc1.evalHistogram(rutile)
+        self.failIf(numpy.allclose(gx, gn))
+        self.failUnless(numpy.allclose(gn, gn1))
+        dpdfc.scatteringfactortable.setCustomAs('Ti', 'Ti', 3)
+        gc = dpdfc.evalHistogram()
+        dpdfc1.scatteringfactortable.setCustomAs('Ti', 'Ti', 3)
+        self.failUnless(numpy.allclose(gc, dpdfc1.evalHistogram()))
+        # mask change must discard the cache
+        dpdfc.setTypeMask('O', 'O', False)
+        dpdfc1.setTypeMask('O', 'O', False)
+        gm = dpdfc.evalHistogram()
+        self.failUnless(numpy.allclose(gm, dpdfc1.evalHistogram(rutile)))
+        self.failIf(numpy.allclose(gc, gm))
+        dpdfc2 = cPickle.loads(cPickle.dumps(dpdfc))
+        self.failUnless(numpy.allclose(gm, dpdfc2.evalHistogram(rutile)))
+        # bond range change must discard the cache
+        dpdfc.rmax = 5
+        gr = dpdfc.evalHistogram()
+        dpdfc3 = DebyePDFCalculator(qmin=1, rmax=5)
+        dpdfc3.setScatteringFactorTableByType('N')
+        dpdfc3.scatteringfactortable.setCustomAs('Ti', 'Ti', 3)
+        dpdfc3.setTypeMask('O', 'O', False)
+        self.failIf(numpy.allclose(gm, gr))
+        self.failUnless(numpy.allclose(gr, dpdfc3.evalHistogram(rutile)))
+        return
+
+    def test_histogramkernel(self):
+        """check the recurrence kernel against the direct one.
+        """
+        dpdfc = self.dpdfc
+        self.assertEqual('recurrence', dpdfc.histogramkernel)
+        dpdfc.qmax = 40
+        dpdfc.delta2 = 1
+        f0 = dpdfc.evalHistogram(self.bucky)
+        dpdfc.histogramkernel = 'direct'
+        f1 = dpdfc.evalHistogram()
+        self.failUnless(_maxNormDiff(f1, f0) < 1e-10)
+        dpdfc.histogramkernel = 'simd'
+        f2 = dpdfc.evalHistogram()
+        self.failUnless(_maxNormDiff(f2, f1) < 1e-10)
+        dpdfc.histogramkernel = 'direct'
+        self.assertRaises(ValueError, setattr,
+                dpdfc, 'histogramkernel', 'invalid')
+        dpdfc1 = cPickle.loads(cPickle.dumps(dpdfc))
+        self.assertEqual('direct', dpdfc1.histogramkernel)
+        return
+
+    def test_evalHistogram_singleprecision(self):
+        """check evalHistogram with single precision sums.
+        """
+        dpdfc = self.dpdfc
+        f0 = dpdfc.evalHistogram(self.bucky)
+        dpdfc.singleprecision = True
+        f1 = dpdfc.evalHistogram()
+        self.assertEqual(numpy.float32, f1.dtype)
+        self.assertEqual(numpy.float32, dpdfc.pdf.dtype)
+        self.failUnless(_maxNormDiff(f1, f0) < 1e-6)
+        return
+
     def test_partial_pdfs(self):
         """Check calculation of partial PDFs.
         """
@@ -149,6 +234,34 @@ class TestDebyePDFCalculator(unittest.TestCase):
         self.failUnless(numpy.allclose(g0, g1 + g2 + g3))
         return
 
+    def test_evalPartials(self):
+        """Check DebyePDFCalculator.evalPartials()
+        """
+        dpdfc = self.dpdfc
+        dpdfc.qmin = 1.0
+        r0, g0 = dpdfc(self.tio2rutile)
+        types, w, gp = dpdfc.evalPartials()
+        self.assertEqual(('O', 'Ti'), types)
+        self.failUnless(numpy.allclose(g0, numpy.tensordot(w, gp)))
+        self.failUnless(numpy.allclose(g0, dpdfc.pdf))
+        return
+
+    def test_evalTables(self):
+        """Check DebyePDFCalculator.evalTables()
+        """
+        dpdfc = self.dpdfc
+        dpdfc.qmin = 1.0
+        rutile = self.tio2rutile
+        r0, gx = dpdfc(rutile)
+        dpdfc.setScatteringFactorTableByType('N')
+        r1, gn = dpdfc(rutile)
+        sftx = dpdfc.scatteringfactortable.createByType('X')
+        gnx = dpdfc.evalTables(['N', sftx])
+        self.failUnless(numpy.allclose(gn, gnx[0]))
+        self.failUnless(numpy.allclose(gx, gnx[1]))
+        self.failUnless(numpy.allclose(gn, dpdfc.pdf))
+        return
+
     def test_pickling(self):
         '''check pickling and unpickling of PDFCalculator.
         '''
@@ -204,6 +317,20 @@ class TestDebyePDFCalculator(unittest.TestCase):
         return
 
 
+    def test_sweep(self):
+        '''Check DebyePDFCalculator.sweep()
+        '''
+        dpdfc = self.dpdfc
+        dpdfc.rmax = 5
+        gs = dpdfc.sweep(self.tio2rutile, scale=[1, 2], qbroad=[0, 0.02])
+        self.assertEqual((4, len(dpdfc.rgrid)), gs.shape)
+        self.failUnless(numpy.allclose(2 * gs[0], gs[1]))
+        self.failUnless(numpy.allclose(2 * gs[2], gs[3]))
+        r, g = dpdfc(self.tio2rutile, scale=1, qbroad=0.02)
+        self.failUnless(numpy.allclose(g, gs[2]))
+        return
+
+
 
 #   def test_getPeakWidthModel(self):
 #       """check DebyePDFCalculator.getPeakWidthModel()
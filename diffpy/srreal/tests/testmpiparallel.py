@@ -0,0 +1,70 @@
+#!/usr/bin/env python
+
+"""Unit tests for diffpy.srreal.mpiparallel
+
+These tests are skipped when srreal_ext was built without MPI.
+Run them on several ranks with
+
+    mpirun -np 4 python -m diffpy.srreal.tests.testmpiparallel
+"""
+
+
+import unittest
+import numpy
+from diffpy.srreal.tests.testutils import TestCaseMPIOptional
+from diffpy.srreal.tests.testutils import loadDiffPyStructure
+from diffpy.srreal.pdfcalculator import PDFCalculator
+from diffpy.srreal.mpiparallel import mpiEval, mpiRankSize
+
+##############################################################################
+class TestMPIEval(TestCaseMPIOptional):
+
+    cdse = None
+    nickel = None
+
+    def setUp(self):
+        if self.cdse is None:
+            type(self).cdse = loadDiffPyStructure('CdSe_cadmoselite.cif')
+            for a in self.cdse:  a.Uisoequiv = 0.003
+        if self.nickel is None:
+            type(self).nickel = loadDiffPyStructure('Ni.cif')
+            for a in self.nickel:  a.Uisoequiv = 0.003
+        return
+
+    def test_mpiEval_pdf(self):
+        """check mpiEval for PDFCalculator and structure broadcast
+        """
+        rank, size = mpiRankSize()
+        g0 = PDFCalculator()(self.cdse)[1]
+        pdfc = PDFCalculator()
+        stru = self.cdse if rank == 0 else self.nickel
+        mpiEval(pdfc, stru)
+        self.failUnless(numpy.allclose(g0, pdfc.pdf))
+        # reuse the last structure
+        pdfc.qmax = 20
+        g1 = PDFCalculator(qmax=20)(self.cdse)[1]
+        mpiEval(pdfc)
+        self.failUnless(numpy.allclose(g1, pdfc.pdf))
+        return
+
+    def test_mpiEval_bonds(self):
+        """check mpiEval for BondCalculator with reduced data strings
+        """
+        from diffpy.srreal.bondcalculator import BondCalculator
+        rank, size = mpiRankSize()
+        d0 = BondCalculator()(self.nickel)
+        bc = BondCalculator()
+        mpiEval(bc, self.nickel)
+        self.failUnless(numpy.array_equal(d0, bc.distances))
+        # data strings are collected at another root
+        stru = self.nickel if rank == size - 1 else self.cdse
+        mpiEval(bc, stru, root=size - 1)
+        self.failUnless(numpy.array_equal(d0, bc.distances))
+        return
+
+# End of class TestMPIEval
+
+if __name__ == '__main__':
+    unittest.main()
+
+# End of file
@@ -243,6 +243,32 @@ class TestOverlapCalculator(unittest.TestCase):
         self.assertAlmostEqual(fdt02, olc.flipDiffTotal(*n02))
         return
 
+    def test_copy(self):
+        """check native copy of OverlapCalculator
+        """
+        olc = self.olc
+        olc.atomradiitable.fromString('Ti:1.6, O:0.66')
+        olc(self.rutile)
+        olc2 = olc.copy()
+        self.assertEqual(olc.totalsquareoverlap, olc2.totalsquareoverlap)
+        olc2.atomradiitable.setCustom('Ti', 1.7)
+        self.assertEqual(1.6, olc.atomradiitable.lookup('Ti'))
+        olc2.eval()
+        self.failUnless(olc2.totalsquareoverlap > olc.totalsquareoverlap)
+        # table mutators of the copy do not change the source
+        mutators = [
+            lambda t: t.setCustom('Ti', 1.8),
+            lambda t: t.fromString('Ti:1.9, Ba:2'),
+            lambda t: t.resetCustom('Ti'),
+            lambda t: t.resetAll(),
+        ]
+        for f in mutators:
+            olc2 = olc.copy()
+            f(olc2.atomradiitable)
+            self.assertEqual({'Ti' : 1.6, 'O' : 0.66},
+                    olc.atomradiitable.getAllCustom())
+        return
+
     def test_getNeighborSites(self):
         """check OverlapCalculator.getNeighborSites
         """
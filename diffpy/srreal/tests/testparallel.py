@@ -7,6 +7,8 @@
 import os
 import unittest
 import multiprocessing
+import cPickle
+import hashlib
 import numpy
 from diffpy.srreal.tests.testutils import loadDiffPyStructure
 from diffpy.srreal.pdfcalculator import PDFCalculator
@@ -70,6 +72,145 @@ class TestRoutines(unittest.TestCase):
         self.failUnless(numpy.allclose(g0a, g2a))
         return
 
+    def test_parallel_singleprecision(self):
+        """check parallel PDFCalculator with float32 partial data
+        """
+        from diffpy.srreal.pdfcalculator import PDFCalculator
+        pdfc = PDFCalculator()
+        r0, g0 = pdfc(self.cdse)
+        pdfc.singleprecision = True
+        self.assertTrue(len(pdfc._getParallelData()) < 8 * len(pdfc.value))
+        ppdfc1 = createParallelCalculator(pdfc, 3, map)
+        r1, g1 = ppdfc1(self.cdse)
+        self.assertEqual(numpy.float32, g1.dtype)
+        self.failUnless(numpy.allclose(g0, g1, atol=1e-5 * abs(g0).max()))
+        ppdfc2 = createParallelCalculator(pdfc,
+                self.ncpu, self.pool.imap_unordered)
+        r2, g2 = ppdfc2(self.cdse)
+        self.assertEqual(numpy.float32, g2.dtype)
+        self.failUnless(numpy.allclose(g1, g2, atol=1e-5 * abs(g0).max()))
+        return
+
+    def test_parallel_sharedmemory(self):
+        """check parallel PDFCalculator with shared memory broadcast
+        """
+        from diffpy.srreal.parallel import _SharedSegment
+        pdfc = PDFCalculator()
+        r0, g0 = pdfc(self.cdse)
+        ppdfc1 = createParallelCalculator(PDFCalculator(), 3, map,
+                sharedmemory=True)
+        r1, g1 = ppdfc1(self.cdse)
+        self.failUnless(numpy.array_equal(r0, r1))
+        self.failUnless(numpy.allclose(g0, g1))
+        ppdfc2 = createParallelCalculator(PDFCalculator(),
+                self.ncpu, self.pool.imap_unordered, sharedmemory=True)
+        r2, g2 = ppdfc2(self.cdse)
+        self.failUnless(numpy.array_equal(r0, r2))
+        self.failUnless(numpy.allclose(g0, g2))
+        # segments are removed after evaluation
+        seg = _SharedSegment(cPickle.dumps(pdfc))
+        path = os.path.join(seg._directory(), seg.name)
+        self.failUnless(os.path.isfile(path))
+        self.assertEqual(seg.digest(seg.name),
+                hashlib.sha1(cPickle.dumps(pdfc)).hexdigest())
+        seg.unlink()
+        self.failIf(os.path.exists(path))
+        segments0 = _listSegments()
+        ppdfc1.eval(self.nickel)
+        self.assertEqual(segments0, _listSegments())
+        # and after an exception in a worker
+        def failingmap(f, arglist):
+            f(arglist[0])
+            raise RuntimeError('worker failed')
+        ppdfc3 = createParallelCalculator(PDFCalculator(), 3, failingmap,
+                sharedmemory=True)
+        self.assertRaises(RuntimeError, ppdfc3.eval, self.nickel)
+        self.assertEqual(segments0, _listSegments())
+        # attached objects are keyed by content, not by the file name
+        pdfc.qmax = 17
+        seg = _SharedSegment(cPickle.dumps(pdfc))
+        self.assertEqual(17, _SharedSegment.attach(seg.name).qmax)
+        seg.unlink()
+        pdfc.qmax = 19
+        seg = _SharedSegment(cPickle.dumps(pdfc))
+        self.assertEqual(19, _SharedSegment.attach(seg.name).qmax)
+        # every job gets its own copy of the attached calculator
+        pc1 = _SharedSegment.attach(seg.name)
+        pc2 = _SharedSegment.attach(seg.name)
+        self.failIf(pc1 is pc2)
+        pc1.qmax = 5
+        self.assertEqual(19, pc2.qmax)
+        seg.unlink()
+        return
+
+    def test_parallel_persistent(self):
+        """check parallel PDFCalculator with resident worker calculators
+        """
+        from diffpy.srreal.parallel import _resident, _SharedSegment
+        segments0 = _listSegments()
+        pdfc = PDFCalculator()
+        ppdfc1 = createParallelCalculator(PDFCalculator(), 3, map,
+                persistent=True)
+        ppdfc2 = createParallelCalculator(PDFCalculator(),
+                self.ncpu, self.pool.imap_unordered, persistent=True)
+        for pc in (pdfc, ppdfc1, ppdfc2):
+            pc.setEvaluatorType('OPTIMIZED')
+        # attribute changes, a structure change and a reverted attribute
+        settings = [{}, {'qmax' : 20}, {'qmax' : 20, 'delta2' : 2},
+                {'delta2' : 2}, {}]
+        for i, kw in enumerate(settings):
+            stru = self.nickel if i == 2 else self.cdse
+            pdfc.qmax = ppdfc1.qmax = ppdfc2.qmax = kw.get('qmax', 0)
+            pdfc.delta2 = ppdfc1.delta2 = ppdfc2.delta2 = kw.get('delta2', 0)
+            r0, g0 = pdfc(stru)
+            r1, g1 = ppdfc1(stru)
+            r2, g2 = ppdfc2(stru)
+            self.failUnless(numpy.array_equal(r0, r1))
+            self.failUnless(numpy.allclose(g0, g1))
+            self.failUnless(numpy.array_equal(r0, r2))
+            self.failUnless(numpy.allclose(g0, g2))
+        self.assertEqual(3, len(_resident))
+        # configuration change starts a new session
+        base = ppdfc1.session.base.name
+        ppdfc1.setTypeMask('Cd', 'Se', False)
+        pdfc.setTypeMask('Cd', 'Se', False)
+        self.failUnless(numpy.allclose(pdfc(self.cdse)[1],
+            ppdfc1(self.cdse)[1]))
+        self.assertNotEqual(base, ppdfc1.session.base.name)
+        # unchanged calculator is not checked again
+        session = ppdfc1.session
+        def nocheck(*args):
+            self.fail('unexpected configuration check')
+        session._sameConfiguration = nocheck
+        g1 = ppdfc1(self.cdse)[1]
+        del session._sameConfiguration
+        # a changed structure of the same size is sent as a delta
+        cdse1 = self.cdse.copy()
+        cdse1[0].xyz += [0.01, 0.02, 0]
+        session._blocksize = 64
+        sbase = session.structurebase.name
+        sdelta = session.structuredelta.name
+        r0, g0 = pdfc(cdse1)
+        r1, g1 = ppdfc1(cdse1)
+        self.failUnless(numpy.allclose(g0, g1))
+        self.assertEqual(sbase, session.structurebase.name)
+        self.assertNotEqual(sdelta, session.structuredelta.name)
+        self.failUnless(_SharedSegment.load(session.structuredelta.name))
+        # the number of resident calculators is limited
+        import diffpy.srreal.parallel as parallel
+        self.assertEqual(16, parallel._residentlimit)
+        parallel._residentlimit = 2
+        try:
+            g1 = ppdfc1(self.nickel)[1]
+        finally:
+            parallel._residentlimit = 16
+        self.failUnless(numpy.allclose(pdfc(self.nickel)[1], g1))
+        self.assertEqual(2, len(_resident))
+        ppdfc1.session.close()
+        ppdfc2.session.close()
+        self.assertEqual(segments0, _listSegments())
+        return
+
     def test_parallel_bonds(self):
         """check parallel BondCalculator
         """
@@ -97,8 +238,61 @@ class TestRoutines(unittest.TestCase):
         self.failUnless(numpy.array_equal(d0a, d2a))
         return
 
+    def test_parallel_treereduction(self):
+        """check pairwise reduction of the parallel results
+        """
+        from diffpy.srreal.bondcalculator import BondCalculator
+        pdfc = PDFCalculator()
+        g0 = pdfc(self.cdse)[1]
+        for kw in ({}, {'sharedmemory' : True}, {'persistent' : True}):
+            ppdfc = createParallelCalculator(PDFCalculator(), 5, map,
+                    treereduction=True, **kw)
+            self.failUnless(numpy.allclose(g0, ppdfc(self.cdse)[1]))
+            # data strings take 3 reduction rounds for 5 jobs
+            pmapcalls = []
+            def countingmap(f, arglist):
+                pmapcalls.append(len(arglist))
+                return self.pool.imap_unordered(f, arglist)
+            pbc = createParallelCalculator(BondCalculator(), 5,
+                    countingmap, treereduction=True, **kw)
+            d0 = BondCalculator()(self.nickel)
+            self.failUnless(numpy.array_equal(d0, pbc(self.nickel)))
+            self.assertEqual([5, 2, 1, 1], pmapcalls)
+        # explicit reduction of the data strings
+        pdfc.setStructure(self.cdse)
+        data = []
+        for i in range(3):
+            pdfc._setupParallelRun(i, 3)
+            pdfc.eval()
+            data.append(pdfc._getParallelData())
+        pdata = pdfc._reduceParallelData(data)
+        pdfc.setStructure(self.cdse)
+        pdfc._mergeParallelData(pdata, 1)
+        self.failUnless(numpy.allclose(g0, pdfc.pdf))
+        # float32 partial values are summed in double precision
+        a = numpy.array([1e8, 1], dtype=numpy.float32)
+        b = numpy.array([1, 2], dtype=numpy.float32)
+        ab = PDFCalculator._reduceParallelValue([a, b])
+        self.assertEqual(numpy.float64, ab.dtype)
+        self.assertEqual([100000001, 3], list(ab))
+        self.assertEqual([100000002, 5],
+                list(PDFCalculator._reduceParallelValue([ab, b])))
+        self.assertRaises(ValueError,
+                PDFCalculator._reduceParallelValue, [a, b[:1]])
+        pdfc.singleprecision = True
+        ppdfc = createParallelCalculator(pdfc, 5, map, treereduction=True)
+        self.failUnless(numpy.allclose(g0, ppdfc(self.cdse)[1],
+            atol=1e-5 * abs(g0).max()))
+        return
+
 # End of class TestRoutines
 
+def _listSegments():
+    from diffpy.srreal.parallel import _SharedSegment
+    d = _SharedSegment._directory()
+    rv = sorted(f for f in os.listdir(d) if f.startswith('srreal-'))
+    return rv
+
 if __name__ == '__main__':
     unittest.main()
 
@@ -6,6 +6,7 @@
 
 import os
 import unittest
+import time
 import cPickle
 
 import numpy
@@ -207,6 +208,196 @@ class TestPDFCalculator(unittest.TestCase):
         self.failUnless(numpy.allclose(rdf0, rdf1 + rdf2 + rdf3))
         return
 
+    def test_evalPartials(self):
+        """Check PDFCalculator.evalPartials()
+        """
+        pc = self.pdfcalc
+        rutile = self.tio2rutile
+        r0, g0 = pc(rutile)
+        types, w, gp = pc.evalPartials(rutile)
+        self.assertEqual(('O', 'Ti'), types)
+        self.assertEqual((2, 2, len(r0)), gp.shape)
+        self.assertAlmostEqual(1.0, w.sum())
+        self.failUnless(numpy.allclose(g0, numpy.tensordot(w, gp)))
+        self.failUnless(numpy.allclose(g0, pc.pdf))
+        self.failUnless(numpy.array_equal(gp[0, 1], gp[1, 0]))
+        # single atom type
+        nickel = self.nickel
+        rn, gn = pc(nickel)
+        tn, wn, gpn = pc.evalPartials(nickel)
+        self.assertEqual(('Ni',), tn)
+        self.assertAlmostEqual(1.0, wn[0, 0])
+        self.failUnless(numpy.allclose(gn, numpy.tensordot(wn, gpn)))
+        self.failUnless(numpy.allclose(gn, pc.pdf))
+        # compare with the masked calculation of the Ti-Ti contribution
+        pc.maskAllPairs(False)
+        r1, gb = pc(rutile)
+        pc.setTypeMask('Ti', 'Ti', True)
+        r1, g1 = pc(rutile)
+        wtiti = w[1, 1]
+        self.failUnless(numpy.allclose(g1 - (1 - wtiti) * gb,
+            wtiti * gp[1, 1]))
+        return
+
+
+    def test_evalPartials_weights(self):
+        """Check site weights used by PDFCalculator.evalPartials()
+        """
+        pc = self.pdfcalc
+        rutile = self.tio2rutile
+        types, w0, gp0 = pc.evalPartials(rutile)
+        self.failUnless('_sitetypecache' in pc.__dict__)
+        # weights follow changes of the scattering factor table
+        sftb = pc.scatteringfactortable
+        sftb.setCustomAs('Ti', 'Ti', sftb.lookup('O'))
+        types, w1, gp1 = pc.evalPartials()
+        self.assertAlmostEqual(1.0 / 9, w1[1, 1], 12)
+        self.assertAlmostEqual(4.0 / 9, w1[0, 1] + w1[1, 0], 12)
+        pc.setScatteringFactorTableByType('N')
+        types, w2, gp2 = pc.evalPartials()
+        self.failIf(numpy.allclose(w1, w2))
+        self.failUnless(numpy.allclose(pc.pdf, numpy.tensordot(w2, gp2)))
+        # pickled calculator starts with an empty cache
+        pc1 = cPickle.loads(cPickle.dumps(pc))
+        types, w3, gp3 = pc1.evalPartials(rutile)
+        self.failUnless(numpy.allclose(w2, w3))
+        return
+
+
+    def test_singleprecision(self):
+        """check PDFCalculator.singleprecision
+        """
+        pc = self.pdfcalc
+        nickel = self.nickel
+        self.assertFalse(pc.singleprecision)
+        r0, g0 = pc(nickel)
+        self.assertEqual(numpy.float64, g0.dtype)
+        pc.singleprecision = True
+        r1, g1 = pc(nickel)
+        self.assertEqual(numpy.float64, r1.dtype)
+        for a in (g1, pc.pdf, pc.rdf, pc.fq, pc.value, pc.eval()):
+            self.assertEqual(numpy.float32, a.dtype)
+        self.failUnless(numpy.allclose(g0, g1, atol=1e-6 * abs(g0).max()))
+        pc1 = cPickle.loads(cPickle.dumps(pc))
+        self.assertTrue(pc1.singleprecision)
+        # float32 parallel data
+        pdata32 = pc._getParallelData()
+        pc.singleprecision = False
+        pdata64 = pc._getParallelData()
+        self.assertTrue(len(pdata32) < len(pdata64))
+        self.assertRaises(ValueError,
+                pc1._mergeParallelData, pdata32[:-1], 1)
+        return
+
+
+    def test_parallelValue(self):
+        """check PDFCalculator._getParallelValue and _mergeParallelValue
+        """
+        pc = self.pdfcalc
+        nickel = self.nickel
+        r0, g0 = pc(nickel)
+        pcs = [cPickle.loads(cPickle.dumps(pc)) for i in range(3)]
+        pvalues = []
+        for i, pci in enumerate(pcs):
+            pci._setupParallelRun(i, 3)
+            pci.eval()
+            pvalues.append(pci._getParallelValue())
+        pvalues = cPickle.loads(cPickle.dumps(pvalues, 2))
+        pc.setStructure(nickel)
+        for pv in pvalues[:-1]:
+            pc._mergeParallelValue(pv, False)
+        pc._mergeParallelValue(memoryview(pvalues[-1]), True)
+        self.failUnless(numpy.allclose(g0, pc.pdf))
+        self.assertRaises(ValueError,
+                pc._mergeParallelValue, pvalues[0][:-1], True)
+        return
+
+
+    def test_evalQmaxes(self):
+        """Check PDFCalculator.evalQmaxes()
+        """
+        pc = self.pdfcalc
+        nickel = self.nickel
+        pc.rmax = 10
+        qmaxes = [0, 15, 25, 40]
+        gall = []
+        for qmax in qmaxes:
+            pc.qmax = qmax
+            gall.append(pc(nickel)[1])
+        pc.qmax = 20
+        r0, g0 = pc(nickel)
+        gq = pc.evalQmaxes(qmaxes)
+        self.assertEqual((4, len(r0)), gq.shape)
+        for g1, g2 in zip(gall, gq):
+            self.failUnless(_maxNormDiff(g1, g2) < 1e-6)
+        self.assertEqual(20, pc.qmax)
+        self.failUnless(numpy.allclose(g0, pc.pdf))
+        return
+
+    def test_evalTables(self):
+        """Check PDFCalculator.evalTables()
+        """
+        pc = self.pdfcalc
+        rutile = self.tio2rutile
+        pc.setScatteringFactorTableByType('N')
+        rn, gn = pc(rutile)
+        pc.setScatteringFactorTableByType('X')
+        rx, gx = pc(rutile)
+        gxn = pc.evalTables(['X', 'N'], rutile)
+        self.assertEqual((2, len(rx)), gxn.shape)
+        self.failUnless(numpy.allclose(gx, gxn[0]))
+        self.failUnless(numpy.allclose(gn, gxn[1]))
+        # the calculator keeps its table and value
+        self.assertEqual('xray', pc.scatteringfactortable.type())
+        self.failUnless(numpy.allclose(gx, pc.pdf))
+        self.assertEqual((0, len(rx)), pc.evalTables([]).shape)
+        # the table is restored when the evaluation fails
+        from diffpy.srreal.scatteringfactortable import ScatteringFactorTable
+        class FailingTable(ScatteringFactorTable):
+            def clone(self):  return FailingTable(self)
+            def create(self): return FailingTable()
+            def _standardLookup(self, smbl, q):
+                raise ValueError("lookup failed")
+            def radiationType(self):   return "rubbish"
+            def type(self):   return "failingtable"
+        self.assertRaises(ValueError, pc.evalTables, ['N', FailingTable()])
+        self.assertEqual('xray', pc.scatteringfactortable.type())
+        self.failUnless(numpy.allclose(gx, pc(rutile)[1]))
+        return
+
+    def test_evalDerivatives(self):
+        """Check PDFCalculator.evalDerivatives()
+        """
+        from diffpy.Structure import Structure
+        pc = PDFCalculator(rmin=2, rmax=5, qmax=25)
+        pc.peakprofile = 'gaussian'
+        pc.peakwidthmodel = 'jeong'
+        pc.delta2 = 1.5
+        ni = Structure(self.nickel)
+        ni[1].xyz += [0.01, -0.02, 0.03]
+        r, g = pc(ni)
+        dgdx, dgdu = pc.evalDerivatives(ni)
+        self.assertEqual((len(ni), 3, len(r)), dgdx.shape)
+        self.assertEqual((len(ni), 6, len(r)), dgdu.shape)
+        self.failUnless(numpy.allclose(g, pc.pdf))
+        h = 1e-5
+        def gshifted(i, dxyz=(0, 0, 0), duiso=0):
+            ni1 = Structure(ni)
+            ni1[i].xyz_cartn = ni1[i].xyz_cartn + dxyz
+            ni1[i].Uisoequiv += duiso
+            return pc(ni1)[1]
+        gdx = (gshifted(1, (h, 0, 0)) - gshifted(1, (-h, 0, 0))) / (2 * h)
+        self.failUnless(_maxNormDiff(gdx, dgdx[1, 0]) < 1e-4)
+        gdz = (gshifted(0, (0, 0, h)) - gshifted(0, (0, 0, -h))) / (2 * h)
+        self.failUnless(_maxNormDiff(gdz, dgdx[0, 2]) < 1e-4)
+        gdu = (gshifted(2, duiso=h) - gshifted(2, duiso=-h)) / (2 * h)
+        self.failUnless(_maxNormDiff(gdu, dgdu[2, :3].sum(axis=0)) < 1e-4)
+        pc.peakwidthmodel = 'constant'
+        dgdx, dgdu = pc.evalDerivatives(ni)
+        self.failIf(numpy.any(dgdu))
+        return
+
+
     def test_full_mask(self):
         '''Test PDFCalculator for a fully masked structure.
         '''
@@ -278,6 +469,110 @@ class TestPDFCalculator(unittest.TestCase):
         self.assertEqual('asdf', pdfc1.foobar)
         return
 
+    def test_copy(self):
+        '''check native copy of PDFCalculator.
+        '''
+        pdfc = self.pdfcalc
+        pdfc.scatteringfactortable = 'N'
+        pdfc.addEnvelope('sphericalshape')
+        pdfc.spdiameter = 13
+        pdfc.foobar = 'asdf'
+        g0 = pdfc(self.nickel)[1]
+        pdfc1 = pdfc.copy()
+        self.failUnless(type(pdfc) is type(pdfc1))
+        self.failUnless(pdfc.getStructure() is pdfc1.getStructure())
+        self.failUnless(numpy.array_equal(g0, pdfc1.pdf))
+        self.assertEqual('asdf', pdfc1.foobar)
+        # components are not shared
+        pdfc1.scatteringfactortable.setCustomAs('Ni', 'Ni', 3)
+        pdfc1.spdiameter = 20
+        pdfc1.delta2 = 1
+        self.assertEqual(13, pdfc.spdiameter)
+        self.assertEqual(0, pdfc.delta2)
+        self.failIf('Ni' in pdfc.scatteringfactortable.getCustomSymbols())
+        pdfc1.eval()
+        self.failIf(numpy.allclose(g0, pdfc1.pdf))
+        self.failUnless(numpy.array_equal(g0, pdfc(self.nickel)[1]))
+        return
+
+    def test_copy_table_mutators(self):
+        '''check table mutators of a copy do not change the source.
+        '''
+        pdfc = self.pdfcalc
+        pdfc.scatteringfactortable = 'N'
+        pdfc.scatteringfactortable.setCustomAs('Ni', 'Ni', 3)
+        sfni = pdfc.scatteringfactortable.lookup('Ni')
+        sfo = pdfc.scatteringfactortable.lookup('O')
+        mutators = [
+            lambda t: t.setCustomAs('Ni', 'Ni', 5),
+            lambda t: t.setCustomAs('Ni', 'Ni', 5, 7),
+            lambda t: t.setCustomAs('O', 'Ni'),
+            lambda t: t.resetCustom('Ni'),
+            lambda t: t.resetAll(),
+        ]
+        for f in mutators:
+            pdfc1 = pdfc.copy()
+            f(pdfc1.scatteringfactortable)
+            self.assertEqual(sfni, pdfc.scatteringfactortable.lookup('Ni'))
+            self.assertEqual(sfo, pdfc.scatteringfactortable.lookup('O'))
+            self.assertEqual(['Ni'], sorted(
+                pdfc.scatteringfactortable.getCustomSymbols()))
+        # and the other way around
+        pdfc1 = pdfc.copy()
+        pdfc.scatteringfactortable.resetAll()
+        self.assertEqual(sfni, pdfc1.scatteringfactortable.lookup('Ni'))
+        # table reference from before the copy stays with the source
+        sft = pdfc.scatteringfactortable
+        sft.setCustomAs('Ni', 'Ni', 3)
+        pdfc1 = pdfc.copy()
+        pdfc2 = pdfc1.copy()
+        sft.setCustomAs('Ni', 'Ni', 4)
+        self.assertEqual(4, pdfc.scatteringfactortable.lookup('Ni'))
+        self.assertEqual(3, pdfc1.scatteringfactortable.lookup('Ni'))
+        self.assertEqual(3, pdfc2.scatteringfactortable.lookup('Ni'))
+        # the copies still share their table until it is changed
+        pdfc1.scatteringfactortable.setCustomAs('Ni', 'Ni', 5)
+        self.assertEqual(5, pdfc1.scatteringfactortable.lookup('Ni'))
+        self.assertEqual(3, pdfc2.scatteringfactortable.lookup('Ni'))
+        self.assertEqual(4, pdfc.scatteringfactortable.lookup('Ni'))
+        return
+
+    def test_pickling_format(self):
+        '''check versioned pickle content and loading of the old format.
+        '''
+        from diffpy.srreal.srreal_ext import _pickleCodecs
+        from diffpy.srreal.srreal_ext import _getPickleCodec, _setPickleCodec
+        pdfc = PDFCalculator(qmax=17)
+        pdfc.eval(self.tio2rutile)
+        codec0 = _getPickleCodec()
+        self.assertEqual('raw', codec0)
+        self.failUnless('raw' in _pickleCodecs())
+        self.assertRaises(ValueError, _setPickleCodec, 'invalid')
+        try:
+            # every codec must round-trip the same calculator
+            for codec in _pickleCodecs() + ('auto',):
+                _setPickleCodec(codec)
+                state = pdfc.__getstate__()
+                content = state[0]
+                self.assertEqual('\0SRP\x01', content[:5])
+                pdfc1 = cPickle.loads(cPickle.dumps(pdfc))
+                self.assertEqual(17, pdfc1.qmax)
+                self.failUnless(numpy.array_equal(pdfc.pdf, pdfc1.pdf))
+                bad = (content[:4] + '\x7f' + content[5:],) + state[1:]
+                self.assertRaises(ValueError, pdfc1.__setstate__, bad)
+                bad = (content[:5] + '\x7f' + content[6:],) + state[1:]
+                self.assertRaises(ValueError, pdfc1.__setstate__, bad)
+            # raw archive without the version header from older pickles
+            _setPickleCodec('raw')
+            state = pdfc.__getstate__()
+            pdfc2 = PDFCalculator()
+            pdfc2.__setstate__((state[0][6:],) + state[1:])
+            self.assertEqual(17, pdfc2.qmax)
+            self.failUnless(numpy.array_equal(pdfc.pdf, pdfc2.pdf))
+        finally:
+            _setPickleCodec(codec0)
+        return
+
     def test_mask_pickling(self):
         '''Check if mask gets properly pickled and restored.
         '''
@@ -309,6 +604,36 @@ class TestPDFCalculator(unittest.TestCase):
         return
 
 
+    def test_sweep(self):
+        '''Check PDFCalculator.sweep()
+        '''
+        pc = self.pdfcalc
+        pc.peakwidthmodel = 'jeong'
+        qdamps = [0, 0.03]
+        delta2s = [0, 1, 2.5]
+        gs = pc.sweep(self.tio2rutile, qdamp=qdamps, delta2=delta2s)
+        self.assertEqual((6, len(pc.rgrid)), gs.shape)
+        for i, d2 in enumerate(delta2s):
+            for j, qd in enumerate(qdamps):
+                r, g = pc(self.tio2rutile, delta2=d2, qdamp=qd)
+                self.failUnless(numpy.allclose(g, gs[2 * i + j]))
+        self.assertRaises(ValueError, pc.sweep, qdampx=[0, 1])
+        self.assertRaises(ValueError, pc.sweep, rmax=[5, 6])
+        # the swept attributes are not changed
+        pc.delta2 = 0.5
+        pc.qdamp = 0.01
+        pc.sweep(delta2=delta2s, qdamp=qdamps, maxextension=[3, 10])
+        self.assertEqual(0.5, pc.delta2)
+        self.assertEqual(0.01, pc.qdamp)
+        self.assertEqual(10, pc.rmax)
+        gs = pc.sweep(maxextension=[3, 10])
+        r, g = pc(maxextension=3)
+        self.failUnless(numpy.allclose(g, gs[0]))
+        r, g = pc(maxextension=10)
+        self.failUnless(numpy.allclose(g, gs[1]))
+        return
+
+
 #   def test_pdf(self):
 #       """check PDFCalculator.pdf
 #       """
@@ -337,6 +662,111 @@ class TestPDFCalculator(unittest.TestCase):
 # End of class TestPDFCalculator
 
 
+##############################################################################
+class TestSineTransform(unittest.TestCase):
+
+    def setUp(self):
+        from diffpy.srreal.pdfcalculator import SineTransform
+        self.sinet = SineTransform()
+        self.qstep = 0.05
+        q = numpy.arange(0, 25, self.qstep)
+        self.f = q * numpy.exp(-0.05 * q**2) * numpy.sin(2.5 * q)
+        return
+
+    def test_ftog(self):
+        """check SineTransform.ftog()
+        """
+        from diffpy.srreal.pdfcalculator import fftftog
+        g0, rstep0 = fftftog(self.f, self.qstep)
+        g1, rstep1 = self.sinet.ftog(self.f, self.qstep)
+        # both lengths are powers of 2, compare on the common r-grid
+        m = max(len(g0), len(g1)) / min(len(g0), len(g1))
+        if len(g0) > len(g1):
+            g0 = g0[::m]
+        else:
+            g1 = g1[::m]
+        self.failUnless(numpy.allclose(g0, g1))
+        self.assertAlmostEqual(max(rstep0, rstep1), m * min(rstep0, rstep1))
+        # round trip
+        f2, qstep2 = self.sinet.gtof(g1, rstep1)
+        self.assertAlmostEqual(self.qstep, qstep2)
+        self.failUnless(numpy.allclose(self.f, f2[:len(self.f)]))
+        self.assertEqual(1, self.sinet.countPlans())
+        # the fftftog length gives the same output grid
+        g2, rstep2 = fftftog(self.f, self.qstep)
+        g3, rstep3 = self.sinet.ftog(self.f, self.qstep, npad=len(g2))
+        self.assertAlmostEqual(rstep2, rstep3)
+        self.failUnless(numpy.allclose(g2, g3))
+        g2, rstep2 = fftftog(self.f, self.qstep, npad=1000)
+        g3, rstep3 = self.sinet.ftog(self.f, self.qstep, npad=1000)
+        self.assertAlmostEqual(rstep2, rstep3)
+        self.failUnless(numpy.allclose(g2, g3))
+        return
+
+    def test_batched(self):
+        """check batched SineTransform transforms with an output buffer
+        """
+        fs = numpy.array([self.f, 2 * self.f, -self.f])
+        g1, rstep = self.sinet.ftog(self.f, self.qstep, qmin=0.5)
+        out = numpy.empty((3, len(g1)))
+        gs, rstep2 = self.sinet.ftog(fs, self.qstep, qmin=0.5, out=out)
+        self.failUnless(gs is out)
+        self.assertEqual(rstep, rstep2)
+        self.failUnless(numpy.allclose(g1, out[0]))
+        self.failUnless(numpy.allclose(2 * g1, out[1]))
+        self.failUnless(numpy.allclose(-g1, out[2]))
+        self.assertRaises(ValueError, self.sinet.ftog,
+                fs, self.qstep, out=numpy.empty(3))
+        self.assertRaises(ValueError, self.sinet.ftog, fs, 0.0)
+        self.sinet.clearPlans()
+        self.assertEqual(0, self.sinet.countPlans())
+        return
+
+    def test_npad(self):
+        """check sine transforms of exact length
+        """
+        from diffpy.srreal.pdfcalculator import fftftog, fftgtof
+        f = self.f[:301]
+        npad = len(f)
+        g, rstep = fftftog(f, self.qstep, npad=npad)
+        self.assertEqual(npad, len(g))
+        self.assertAlmostEqual(numpy.pi / (npad * self.qstep), rstep)
+        k = numpy.arange(npad)
+        sinkj = numpy.sin(numpy.pi * numpy.outer(k, k) / npad)
+        gdirect = 2 / numpy.pi * self.qstep * numpy.dot(sinkj, f)
+        self.failUnless(numpy.allclose(gdirect, g))
+        f1, qstep1 = fftgtof(g, rstep, npad=npad)
+        self.assertAlmostEqual(self.qstep, qstep1)
+        self.failUnless(numpy.allclose(f, f1))
+        g2, rstep2 = self.sinet.ftog([f, f], self.qstep, npad=npad)
+        self.failUnless(numpy.allclose(g, g2[1]))
+        self.assertRaises(ValueError, fftftog, f, self.qstep, 0.1, npad)
+        return
+
+    def test_npad_prime(self):
+        """check sine transforms of lengths with large prime factors
+        """
+        from diffpy.srreal.pdfcalculator import fftftog, fftgtof
+        # 1031 is a prime above the direct summation radix
+        npad = 1031
+        f = numpy.resize(self.f, npad)
+        g, rstep = fftftog(f, self.qstep, npad=npad)
+        k = numpy.arange(npad)
+        sinkj = numpy.sin(numpy.pi * numpy.outer(k, k) / npad)
+        gdirect = 2 / numpy.pi * self.qstep * numpy.dot(sinkj, f)
+        self.failUnless(numpy.allclose(gdirect, g))
+        # 65537 is a prime, direct summation would take minutes
+        npad = 65537
+        f = numpy.resize(self.f, npad)
+        t0 = time.time()
+        g, rstep = fftftog(f, self.qstep, npad=npad)
+        f1, qstep1 = fftgtof(g, rstep, npad=npad)
+        self.failUnless(time.time() - t0 < 10)
+        self.failUnless(numpy.allclose(f, f1))
+        return
+
+# End of class TestSineTransform
+
 if __name__ == '__main__':
     unittest.main()
 
@@ -47,6 +47,42 @@ class TestScatteringFactorTable(unittest.TestCase):
         self.assertEqual(self.sftx.type(), sftx1.type())
         return
 
+    def test_lookupArray(self):
+        """check ScatteringFactorTable.lookupArray()
+        """
+        import numpy
+        from diffpy.srreal.structureadapter import atomTypeId
+        q = numpy.linspace(0, 25, 101)
+        sfa = self.sftx.lookupArray(['O', 'Ti2+', atomTypeId('Ti')], q)
+        self.assertEqual((3, 101), sfa.shape)
+        self.assertEqual(self.sftx.lookup('O', q[7]), sfa[0, 7])
+        self.assertEqual(self.sftx.lookup('Ti2+', q[50]), sfa[1, 50])
+        self.assertEqual(self.sftx.lookup('Ti', q[-1]), sfa[2, -1])
+        out = numpy.zeros((1, 101))
+        sfc = self.sftx.lookupArray('C', q, out=out)
+        self.assertTrue(sfc is out)
+        self.assertEqual(self.sftx.lookup('C', q[3]), out[0, 3])
+        self.assertRaises(ValueError, self.sftx.lookupArray,
+                ['C', 'O'], q, out)
+        self.assertEqual((2, 0), self.sftn.lookupArray(['C', 'O'], []).shape)
+        return
+
+    def test_lookupId(self):
+        """check ScatteringFactorTable.lookupId()
+        """
+        from diffpy.srreal.structureadapter import atomTypeId
+        tid = atomTypeId('Ti')
+        self.assertEqual(self.sftx.lookup('Ti', 3), self.sftx.lookupId(tid, 3))
+        self.assertEqual(self.sftn.lookup('Ti'), self.sftn.lookupId(tid))
+        self.assertRaises(ValueError, self.sftx.lookupId, -1)
+        # cached values follow Q and the table changes
+        self.assertEqual(self.sftx.lookup('Ti'), self.sftx.lookupId(tid))
+        self.sftx.setCustomAs('Ti', 'Ti', 13)
+        self.assertEqual(13, self.sftx.lookupId(tid))
+        self.sftx.resetCustom('Ti')
+        self.assertEqual(self.sftx.lookup('Ti'), self.sftx.lookupId(tid))
+        return
+
     def test_pickling_derived(self):
         """check pickling of a derived classes.
         """
@@ -65,6 +101,40 @@ class TestScatteringFactorTable(unittest.TestCase):
         self.assertEqual(1, lsft1.lookup('H'))
         return
 
+
+    def test_lookupCache(self):
+        """check memoization of the Python-defined _standardLookup.
+        """
+        class CountingTable(LocalTable):
+            ncalls = 0
+            def _standardLookup(self, smbl, q):
+                self.ncalls += 1
+                return LocalTable._standardLookup(self, smbl, q)
+        ctb = CountingTable()
+        self.assertEqual(3, ctb.lookup('Na', 2))
+        self.assertEqual(1, ctb.ncalls)
+        self.assertEqual(3, ctb.lookup('Na', 2))
+        self.assertEqual(1, ctb.ncalls)
+        self.assertEqual(3.5, ctb.lookup('Na', 2.5))
+        self.assertEqual(3, ctb.lookup('Cl', 2))
+        self.assertEqual(3, ctb.ncalls)
+        ctb._resetLookupCache()
+        self.assertEqual(3, ctb.lookup('Na', 2))
+        self.assertEqual(4, ctb.ncalls)
+        # ticker change from setCustomAs discards the memoized values
+        ctb.setCustomAs('Cl', 'Cl', 7)
+        n = ctb.ncalls
+        self.assertEqual(3, ctb.lookup('Na', 2))
+        self.assertEqual(n + 1, ctb.ncalls)
+        ctb.resetAll()
+        self.assertEqual(3, ctb.lookup('Na', 2))
+        self.assertEqual(n + 2, ctb.ncalls)
+        self.assertEqual(3, ctb.lookup('Na', 2))
+        self.assertEqual(n + 2, ctb.ncalls)
+        # no-op for the C++ tables
+        self.sftx._resetLookupCache()
+        return
+
 # End of class TestC
 
 if __name__ == '__main__':
@@ -6,6 +6,7 @@
 
 import os
 import unittest
+import tempfile
 import cPickle
 import numpy
 from diffpy.Structure import Structure
@@ -56,6 +57,20 @@ class TestRoutines(unittest.TestCase):
             adpt.siteCartesianUij(1), adpt1.siteCartesianUij(1)))
         return
 
+    def test_siteTypeId(self):
+        '''check siteTypeId method and interned atom types.
+        '''
+        adpt = createStructureAdapter(nickel)
+        tid = adpt.siteTypeId(0)
+        self.assertEqual(tid, atomTypeId('Ni'))
+        self.assertEqual(tid, adpt.siteTypeId(3))
+        self.assertEqual('Ni', atomTypeOfId(tid))
+        tid1 = atomTypeId('Ni2+')
+        self.assertNotEqual(tid, tid1)
+        self.assertEqual(tid1, atomTypeId('Ni2+'))
+        self.assertRaises(ValueError, atomTypeOfId, -1)
+        return
+
 # End of class TestStructureAdapter
 
 
@@ -148,6 +163,102 @@ class TestNoSymmetry(unittest.TestCase):
 # End of class TestNoSymmetry
 
 
+##############################################################################
+class TestLoadXYZ(unittest.TestCase):
+
+    def setUp(self):
+        fd, self.xyzfile = tempfile.mkstemp(suffix='.xyz')
+        os.close(fd)
+        return
+
+    def tearDown(self):
+        os.remove(self.xyzfile)
+        return
+
+    def _write(self, content):
+        fp = open(self.xyzfile, 'w')
+        fp.write(content)
+        fp.close()
+        return
+
+    def test_loadXYZ(self):
+        '''check loading of plain XYZ files.
+        '''
+        lines = ['%s %r %r %r %r' % ((a.element,) + tuple(xyz) +
+            (a.Uisoequiv,)) for a, xyz in zip(nickel, nickel.xyz_cartn)]
+        self._write('4\nnickel\n' + '\n'.join(lines) + '\n')
+        adpt = loadXYZ(self.xyzfile)
+        self.failUnless(type(adpt) is XYZStructureAdapter)
+        self.assertEqual(4, adpt.countSites())
+        self.assertEqual(0, adpt.numberDensity())
+        self.assertEqual('Ni', adpt.siteAtomType(3))
+        self.failUnless(numpy.allclose(
+            nickel.xyz_cartn[3], adpt.siteCartesianPosition(3)))
+        # extra columns of plain XYZ are ignored
+        self.failUnless(numpy.array_equal(numpy.zeros((3, 3)),
+            adpt.siteCartesianUij(3)))
+        self.assertEqual(1, adpt.siteOccupancy(3))
+        from diffpy.srreal.bondcalculator import BondCalculator
+        bc = BondCalculator(rmax=5)
+        d0 = numpy.sort(bc(nosymmetry(nickel)))
+        d1 = numpy.sort(bc(adpt))
+        self.failUnless(numpy.allclose(d0, d1))
+        adpt1 = cPickle.loads(cPickle.dumps(adpt))
+        self.failUnless(type(adpt1) is XYZStructureAdapter)
+        self.failUnless(numpy.array_equal(
+            adpt.siteCartesianPosition(2), adpt1.siteCartesianPosition(2)))
+        return
+
+    def test_loadXYZ_extended(self):
+        '''check loading of extended XYZ files.
+        '''
+        self._write('2\nLattice="5 0 0 0 5 0 0 0 5" '
+                'Properties=species:S:1:pos:R:3:Z:I:1:occupancy:R:1:'
+                'Uiso:R:1\n'
+                'Ni 0 0 0 28 0.5 0.003\n'
+                'O  1 2 3  8 1.0 0.004\n')
+        adpt = loadXYZ(self.xyzfile)
+        self.assertEqual(2, adpt.countSites())
+        self.assertEqual(0, adpt.numberDensity())
+        self.assertEqual('O', adpt.siteAtomType(1))
+        self.failUnless(numpy.array_equal([1, 2, 3],
+            adpt.siteCartesianPosition(1)))
+        self.assertEqual(0.5, adpt.siteOccupancy(0))
+        self.assertEqual(1.5, adpt.totalOccupancy())
+        self.assertEqual(0.004, adpt.siteCartesianUij(1)[2, 2])
+        return
+
+    def test_loadXYZ_invalid(self):
+        '''check loadXYZ with invalid files.
+        '''
+        self._write('3\nshort\nNi 0 0 0\n')
+        self.assertRaises(ValueError, loadXYZ, self.xyzfile)
+        self._write('1\nbad number\nNi 0 0 x\n')
+        self.assertRaises(ValueError, loadXYZ, self.xyzfile)
+        self._write('2\ntrailing garbage\nNi 0 0 0\nNi 0 0 1.5x\n')
+        try:
+            loadXYZ(self.xyzfile)
+            self.fail('expected ValueError for invalid number')
+        except ValueError, e:
+            self.failUnless(':4:' in str(e))
+        self._write('1\ndecimal comma\nNi 0 0 1,5\n')
+        self.assertRaises(ValueError, loadXYZ, self.xyzfile)
+        # atom count must fit in the remaining lines
+        for n in ('2', '100000000', '30000000000'):
+            self._write(n + '\nhuge count\nNi 0 0 0\n')
+            try:
+                loadXYZ(self.xyzfile)
+                self.fail('expected ValueError for atom count ' + n)
+            except ValueError, e:
+                self.failUnless(':1:' in str(e))
+        self._write('1\nProperties=pos:R:3\n0 0 0\n')
+        self.assertRaises(ValueError, loadXYZ, self.xyzfile)
+        self.assertRaises(ValueError, loadXYZ, self.xyzfile + '.missing')
+        return
+
+# End of class TestLoadXYZ
+
+
 ##############################################################################
 class TestPyObjCrystAdapter(TestCaseObjCrystOptional):
 
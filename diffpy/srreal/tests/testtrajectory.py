@@ -0,0 +1,156 @@
+#!/usr/bin/env python
+
+"""Unit tests for diffpy.srreal.trajectory
+"""
+
+
+import os
+import unittest
+import tempfile
+import cPickle
+import numpy
+from diffpy.srreal.tests.testutils import loadDiffPyStructure
+from diffpy.srreal.pdfcalculator import PDFCalculator
+from diffpy.srreal.bondcalculator import BondCalculator
+from diffpy.srreal.trajectory import *
+
+##############################################################################
+class TestTrajectory(unittest.TestCase):
+
+    c60 = None
+
+    def setUp(self):
+        if self.c60 is None:
+            type(self).c60 = loadDiffPyStructure('C60bucky.stru')
+        self.tmpfiles = []
+        xyz0 = self.c60.xyz_cartn
+        self.frames = [xyz0 * (1 + 0.01 * i) for i in range(5)]
+        self.symbols = [a.element for a in self.c60]
+        self.trjfile = self._tmpfile()
+        writeTrajectory(self.trjfile, self.symbols, self.frames, 0.004)
+        return
+
+    def tearDown(self):
+        for f in self.tmpfiles:
+            os.remove(f)
+        return
+
+    def _tmpfile(self):
+        fd, path = tempfile.mkstemp(prefix='srreal-', suffix='.trj')
+        os.close(fd)
+        self.tmpfiles.append(path)
+        return path
+
+    def test_adapter(self):
+        """check TrajectoryStructureAdapter frames and sites.
+        """
+        adpt = TrajectoryStructureAdapter(self.trjfile, 2)
+        self.assertEqual(self.trjfile, adpt.filename)
+        self.assertEqual(5, adpt.countFrames())
+        self.assertEqual(60, adpt.countSites())
+        self.assertEqual(0, adpt.numberDensity())
+        self.assertEqual('C', adpt.siteAtomType(7))
+        self.failUnless(numpy.allclose(
+            0.004 * numpy.identity(3), adpt.siteCartesianUij(7)))
+        self.assertEqual(2, adpt.getFrame())
+        self.failUnless(numpy.array_equal(
+            self.frames[2][7], adpt.siteCartesianPosition(7)))
+        adpt.setFrame(4)
+        self.failUnless(numpy.array_equal(
+            self.frames[4][7], adpt.siteCartesianPosition(7)))
+        self.assertRaises(ValueError, adpt.setFrame, 5)
+        self.assertRaises(ValueError, adpt.setFrame, -1)
+        self.assertEqual(4, adpt.getFrame())
+        bc = BondCalculator(rmax=1.5)
+        self.assertEqual(180, len(bc(adpt)))
+        return
+
+    def test_invalid_file(self):
+        """check TrajectoryStructureAdapter with invalid files.
+        """
+        fnm = self._tmpfile()
+        open(fnm, 'wb').write(open(self.trjfile, 'rb').read()[:-8])
+        self.assertRaises(ValueError, TrajectoryStructureAdapter, fnm)
+        open(fnm, 'wb').write(100 * 'x')
+        self.assertRaises(ValueError, TrajectoryStructureAdapter, fnm)
+        self.assertRaises(ValueError, TrajectoryStructureAdapter,
+                fnm + '.missing')
+        return
+
+    def test_evalFrames(self):
+        """check evalFrames averaging over frame ranges.
+        """
+        pdfc = PDFCalculator(rmax=10)
+        g = [pdfc(TrajectoryStructureAdapter(self.trjfile, i))[1]
+                for i in range(5)]
+        adpt = TrajectoryStructureAdapter(self.trjfile)
+        gavg = evalFrames(pdfc, adpt)
+        self.assertEqual(len(g[0]), len(gavg))
+        self.failUnless(numpy.allclose(numpy.mean(g, axis=0), gavg))
+        self.failUnless(numpy.array_equal(gavg, pdfc.pdf))
+        gavg = evalFrames(pdfc, self.trjfile, 1, stride=2)
+        self.failUnless(numpy.allclose((g[1] + g[3]) / 2, gavg))
+        self.assertEqual(0, adpt.getFrame())
+        # the next eval starts from scratch
+        adpt2 = TrajectoryStructureAdapter(self.trjfile, 2)
+        self.failUnless(numpy.allclose(g[2], pdfc(adpt2)[1]))
+        bc = BondCalculator(rmax=1.5)
+        self.assertRaises(ValueError, evalFrames, bc, adpt)
+        self.assertRaises(ValueError, evalFrames, pdfc, adpt, 5)
+        self.assertRaises(ValueError, evalFrames, pdfc, adpt, 0, 5, 0)
+        return
+
+    def test_pickling(self):
+        """check pickling of TrajectoryStructureAdapter.
+        """
+        adpt = TrajectoryStructureAdapter(self.trjfile, 3)
+        adpt1 = cPickle.loads(cPickle.dumps(adpt))
+        self.assertEqual(3, adpt1.getFrame())
+        self.failUnless(numpy.array_equal(
+            adpt.siteCartesianPosition(9), adpt1.siteCartesianPosition(9)))
+        pdfc = PDFCalculator(rmax=10)
+        pdfc.eval(adpt)
+        pdfc1 = cPickle.loads(cPickle.dumps(pdfc))
+        self.failUnless(numpy.array_equal(pdfc.pdf, pdfc1.pdf))
+        self.assertEqual(60, pdfc1.getStructure().countSites())
+        # pickles keep the absolute path of a relative file name
+        cwd = os.getcwd()
+        trjdir, trjname = os.path.split(self.trjfile)
+        os.chdir(trjdir)
+        try:
+            trjpath = os.path.join(os.getcwd(), trjname)
+            adpt2 = TrajectoryStructureAdapter(trjname, 1)
+            s = cPickle.dumps(adpt2)
+        finally:
+            os.chdir(cwd)
+        self.assertEqual(trjpath, adpt2.filename)
+        adpt3 = cPickle.loads(s)
+        self.assertEqual(trjpath, adpt3.filename)
+        self.assertEqual(1, adpt3.getFrame())
+        return
+
+    def test_convertXYZTrajectory(self):
+        """check conversion of multi-frame XYZ file.
+        """
+        xyzfile = self._tmpfile()
+        fp = open(xyzfile, 'w')
+        fp.write('2\nframe 0\nNi 0 0 0\nO 1 2 3\n')
+        fp.write('2\nframe 1\nNi 0 0 1\nO 1 2 4.5\n')
+        fp.close()
+        trjfile = self._tmpfile()
+        self.assertEqual(2, convertXYZTrajectory(xyzfile, trjfile))
+        adpt = TrajectoryStructureAdapter(trjfile, 1)
+        self.assertEqual('O', adpt.siteAtomType(1))
+        self.failUnless(numpy.array_equal([1, 2, 4.5],
+            adpt.siteCartesianPosition(1)))
+        open(xyzfile, 'a').write('2\nframe 2\nNi 0 0 0\nNi 1 2 3\n')
+        self.assertRaises(ValueError,
+                convertXYZTrajectory, xyzfile, trjfile)
+        return
+
+# End of class TestTrajectory
+
+if __name__ == '__main__':
+    unittest.main()
+
+# End of file
@@ -4,6 +4,8 @@
 
 TestCaseObjCrystOptional -- use this as a TestCase base class that
     disables unit tests when pyobjcryst is not installed.
+TestCaseMPIOptional -- TestCase base class that disables unit tests
+    when srreal_ext was built without MPI.
 """
 
 
@@ -19,6 +21,23 @@ except ImportError:
     TestCaseObjCrystOptional = object
     logging.warning('Cannot import pyobjcryst, pyobjcryst tests skipped.')
 
+# class TestCaseMPIOptional
+
+from unittest import TestCase, SkipTest
+
+class TestCaseMPIOptional(TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+        # mpiparallel is optional, import it only for the MPI tests
+        from diffpy.srreal.mpiparallel import mpiAvailable
+        if not mpiAvailable():
+            logging.warning('srreal_ext built without MPI, MPI tests skipped.')
+            raise SkipTest('srreal_ext built without MPI')
+        return
+
+# End of class TestCaseMPIOptional
+
 # helper functions
 
 def datafile(filename):
@@ -0,0 +1,217 @@
+#!/usr/bin/env python
+##############################################################################
+#
+# diffpy.srreal     by DANSE Diffraction group
+#                   Simon J. L. Billinge
+#                   (c) 2013 Trustees of the Columbia University
+#                   in the City of New York.  All rights reserved.
+#
+# File coded by:    Pavol Juhas
+#
+# See AUTHORS.txt for a list of people who contributed.
+# See LICENSE.txt for license information.
+#
+##############################################################################
+
+
+"""Memory-mapped binary trajectories of non-periodic structures.
+
+Classes:
+
+TrajectoryStructureAdapter -- StructureAdapter for one trajectory frame
+
+Routines:
+
+evalFrames           -- average PairQuantity values over trajectory frames
+writeTrajectory      -- write coordinate frames to a binary trajectory file
+convertXYZTrajectory -- convert multi-frame XYZ file to binary trajectory
+
+Layout of the binary trajectory file, all values are little-endian:
+
+    8 bytes             magic "SRTRAJ\\0\\0"
+    int32               format version, currently 1
+    int32               number of atoms N
+    int64               number of frames M
+    N * 8 bytes         atom type symbols padded with NUL characters
+    N * float64         isotropic displacement parameters Uiso
+    M * N * 3 float64   cartesian coordinates for every frame and atom
+
+The atom types and displacement parameters are the same in all frames.
+"""
+
+
+# exported items
+__all__ = ['TrajectoryStructureAdapter', 'evalFrames',
+        'writeTrajectory', 'convertXYZTrajectory']
+
+import struct
+import numpy
+from diffpy.srreal.srreal_ext import TrajectoryStructureAdapter
+from diffpy.srreal.srreal_ext import _evalFrames
+
+_MAGIC = 'SRTRAJ\0\0'
+_VERSION = 1
+_SYMBOLSIZE = 8
+
+# ----------------------------------------------------------------------------
+
+def evalFrames(pqobj, traj, start=0, stop=None, stride=1):
+    '''Evaluate PairQuantity calculator for a range of trajectory frames.
+
+    The frames are evaluated in C++ without any Python calls per frame.
+
+    pqobj    -- PairQuantity calculator to be evaluated
+    traj     -- TrajectoryStructureAdapter or a path to trajectory file.
+                The current frame of traj is not changed.
+    start    -- index of the first frame
+    stop     -- frame index where to stop, the last frame when None
+    stride   -- step between the evaluated frames
+
+    Return numpy array of the frame-averaged result, which is the PDF
+    for PDFCalculator and DebyePDFCalculator and the value attribute
+    for other calculators.  The pair sums are averaged over the frames
+    and pqobj is finished once from the mean sums, its other results
+    such as rdf are thus frame averages too.  pqobj keeps a copy of
+    traj at the last evaluated frame.
+    Raise ValueError for an empty frame range or when the length of
+    the values changes between frames.
+    '''
+    from diffpy.srreal.pdfcalculator import PDFCalculator
+    from diffpy.srreal.pdfcalculator import DebyePDFCalculator
+    if not isinstance(traj, TrajectoryStructureAdapter):
+        traj = TrajectoryStructureAdapter(traj)
+    if stop is None:
+        stop = traj.countFrames()
+    rv = _evalFrames(pqobj, traj, start, stop, stride)
+    if isinstance(pqobj, (PDFCalculator, DebyePDFCalculator)):
+        rv = pqobj.pdf
+    return rv
+
+
+def writeTrajectory(filename, symbols, frames, uiso=0.0):
+    '''Write coordinate frames to a binary trajectory file.
+
+    filename -- path to the output file
+    symbols  -- list of N atom type symbols, at most 8 characters long
+    frames   -- array of cartesian coordinates shaped (M, N, 3)
+    uiso     -- isotropic displacement parameter, either a single value
+                or an array of N values for every atom
+
+    No return value.
+    '''
+    xyz = numpy.asarray(frames, dtype=float).reshape(-1, len(symbols), 3)
+    fp = _TrajectoryWriter(filename, symbols, uiso)
+    try:
+        for fxyz in xyz:
+            fp.writeFrame(fxyz)
+    finally:
+        fp.close()
+    return
+
+
+def convertXYZTrajectory(xyzfile, filename, uiso=0.0):
+    '''Convert multi-frame XYZ file to a binary trajectory file.
+
+    Every frame of the XYZ file starts with the number of atoms and
+    a comment line followed by lines with atom symbol and cartesian
+    coordinates.  All frames must have the same atom symbols.
+
+    xyzfile  -- path to the input XYZ file
+    filename -- path to the output binary trajectory
+    uiso     -- isotropic displacement parameter for all atoms
+
+    Return the number of converted frames.
+    Raise ValueError for invalid or inconsistent XYZ frames.
+    '''
+    fp = None
+    nframes = 0
+    try:
+        for symbols, xyz in _iterXYZFrames(xyzfile):
+            if fp is None:
+                fp = _TrajectoryWriter(filename, symbols, uiso)
+            elif symbols != fp.symbols:
+                emsg = "%s: atom types differ in frame %i." % (
+                        xyzfile, nframes)
+                raise ValueError(emsg)
+            fp.writeFrame(xyz)
+            nframes += 1
+    finally:
+        if fp is not None:
+            fp.close()
+    if fp is None:
+        raise ValueError("%s: no XYZ frames found." % xyzfile)
+    return nframes
+
+# Local Helpers --------------------------------------------------------------
+
+class _TrajectoryWriter(object):
+    '''Writer of binary trajectory that updates the frame count on close.
+    '''
+
+    def __init__(self, filename, symbols, uiso):
+        self.symbols = list(symbols)
+        natoms = len(self.symbols)
+        for smbl in self.symbols:
+            if not 0 < len(smbl) <= _SYMBOLSIZE:
+                emsg = "Invalid atom type symbol %r." % smbl
+                raise ValueError(emsg)
+        uisoarray = numpy.empty(natoms, dtype='<f8')
+        uisoarray[:] = uiso
+        self.nframes = 0
+        self._fp = open(filename, 'wb')
+        self._fp.write(self._header())
+        self._fp.write(''.join(s.ljust(_SYMBOLSIZE, '\0')
+            for s in self.symbols))
+        self._fp.write(uisoarray.tostring())
+        return
+
+
+    def writeFrame(self, xyz):
+        a = numpy.asarray(xyz, dtype='<f8')
+        if a.shape != (len(self.symbols), 3):
+            emsg = "Frame coordinates must have shape (%i, 3)." % (
+                    len(self.symbols))
+            raise ValueError(emsg)
+        self._fp.write(a.tostring())
+        self.nframes += 1
+        return
+
+
+    def close(self):
+        self._fp.seek(0)
+        self._fp.write(self._header())
+        self._fp.close()
+        return
+
+
+    def _header(self):
+        return _MAGIC + struct.pack('<iiq',
+                _VERSION, len(self.symbols), self.nframes)
+
+# End of class _TrajectoryWriter
+
+
+def _iterXYZFrames(xyzfile):
+    '''Generate (symbols, xyz) tuples for the frames in XYZ file.
+    '''
+    fp = open(xyzfile)
+    try:
+        lines = iter(fp)
+        for line in lines:
+            if not line.strip():
+                continue
+            try:
+                natoms = int(line)
+                next(lines)
+                words = [next(lines).split() for i in range(natoms)]
+                symbols = [w[0] for w in words]
+                xyz = numpy.array([w[1:4] for w in words], dtype=float)
+            except (ValueError, IndexError, StopIteration):
+                emsg = "%s: invalid XYZ frame." % xyzfile
+                raise ValueError(emsg)
+            yield symbols, xyz.reshape(natoms, 3)
+    finally:
+        fp.close()
+    return
+
+# End of file
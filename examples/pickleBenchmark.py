@@ -0,0 +1,57 @@
+#!/usr/bin/env python
+
+"""Benchmark of pickling and unpickling of PDFCalculator with a structure.
+A menthol structure is expanded to a supercell of the specified size,
+the calculator is evaluated and then repeatedly pickled and unpickled.
+The script prints the pickle size and throughput in MB/s for every pickle
+codec available in srreal_ext and for the 'auto' selection.  Build
+srreal_ext with "scons lz4=True" for the LZ4 compressed pickles.
+"""
+
+import os
+import sys
+import optparse
+import time
+import cPickle
+from diffpy.Structure import Structure
+from diffpy.Structure.expansion import supercell
+from diffpy.srreal.pdfcalculator import PDFCalculator
+from diffpy.srreal.srreal_ext import _pickleCodecs, _setPickleCodec
+
+mydir = os.path.dirname(os.path.abspath(__file__))
+mentholcif = os.path.join(mydir, 'datafiles', 'menthol.cif')
+
+# configure options parsing
+parser = optparse.OptionParser("%prog [options]\n" +
+    __doc__)
+parser.add_option("--size", type="int", default=3,
+        help="Supercell multiple along each axis [%default].")
+parser.add_option("--repeat", type="int", default=20,
+        help="Number of pickling round trips [%default].")
+parser.allow_interspersed_args = True
+opts, args = parser.parse_args(sys.argv[1:])
+
+menthol = Structure(filename=mentholcif)
+for a in menthol:
+    a.Uisoequiv = a.Uisoequiv or 0.005
+n = opts.size
+stru = supercell(menthol, (n, n, n))
+pc = PDFCalculator(rmax=10)
+pc.eval(stru)
+print "Structure with %i atoms" % len(stru)
+
+for codec in _pickleCodecs() + ('auto',):
+    _setPickleCodec(codec)
+    t0 = time.time()
+    for i in range(opts.repeat):
+        s = cPickle.dumps(pc, cPickle.HIGHEST_PROTOCOL)
+    t0 = (time.time() - t0) / opts.repeat
+    t1 = time.time()
+    for i in range(opts.repeat):
+        pc1 = cPickle.loads(s)
+    t1 = (time.time() - t1) / opts.repeat
+    mb = len(s) / 1e6
+    print "Codec %r" % codec
+    print "  Pickle size: %g MB" % mb
+    print "  Pickling:    %g s, %g MB/s" % (t0, mb / t0)
+    print "  Unpickling:  %g s, %g MB/s" % (t1, mb / t1)
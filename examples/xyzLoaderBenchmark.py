@@ -0,0 +1,55 @@
+#!/usr/bin/env python
+
+"""Benchmark of the native XYZ loader against the diffpy.Structure path.
+A random XYZ file with the specified number of atoms is written to
+a temporary file, which is then loaded with diffpy.srreal.structureadapter
+loadXYZ and with diffpy.Structure followed by createStructureAdapter.
+The script prints the load time and throughput of both methods.
+"""
+
+import os
+import sys
+import optparse
+import tempfile
+import time
+import numpy
+from diffpy.Structure import Structure
+from diffpy.srreal.structureadapter import loadXYZ, createStructureAdapter
+
+# configure options parsing
+parser = optparse.OptionParser("%prog [options]\n" +
+    __doc__)
+parser.add_option("--natoms", type="int", default=100000,
+        help="Number of atoms in the XYZ file [%default].")
+parser.add_option("--skip-python", action="store_true",
+        help="Skip the slow diffpy.Structure loader.")
+parser.allow_interspersed_args = True
+opts, args = parser.parse_args(sys.argv[1:])
+
+xyz = 100 * numpy.random.random((opts.natoms, 3))
+fd, xyzfile = tempfile.mkstemp(suffix='.xyz')
+fp = os.fdopen(fd, 'w')
+fp.write("%i\nrandom structure\n" % opts.natoms)
+fp.writelines("C %.6f %.6f %.6f\n" % tuple(r) for r in xyz)
+fp.close()
+mb = os.path.getsize(xyzfile) / 1e6
+print "XYZ file with %i atoms, %g MB" % (opts.natoms, mb)
+
+def report(label, t):
+    print "%-20s %8.3f s, %10.0f atoms/s, %8.2f MB/s" % (
+            label, t, opts.natoms / t, mb / t)
+    return
+
+try:
+    t0 = time.time()
+    adpt = loadXYZ(xyzfile)
+    report("loadXYZ", time.time() - t0)
+    assert adpt.countSites() == opts.natoms
+    if not opts.skip_python:
+        t0 = time.time()
+        stru = Structure(filename=xyzfile, format='xyz')
+        adpt1 = createStructureAdapter(stru)
+        report("diffpy.Structure", time.time() - t0)
+        assert adpt1.countSites() == opts.natoms
+finally:
+    os.remove(xyzfile)
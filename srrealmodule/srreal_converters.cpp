@@ -102,6 +102,41 @@ NumPyArray_DoublePtr createNumPyDoubleArray(int dim, const int* sz)
 }
 
 
+/// helper for output arguments of numpy array of doubles
+NumPyArray_DoublePtr
+useNumPyDoubleArray(boost::python::object out, int dim, const int* sz)
+{
+    if (Py_None == out.ptr())  return createNumPyDoubleArray(dim, sz);
+    PyObject* pout = out.ptr();
+    bool goodout = PyArray_Check(pout) &&
+        (PyArray_DOUBLE == PyArray_TYPE(pout)) &&
+        PyArray_ISCARRAY(pout) && (dim == PyArray_NDIM(pout));
+    for (int i = 0; goodout && i < dim; ++i)
+    {
+        goodout = (sz[i] == PyArray_DIM(pout, i));
+    }
+    if (!goodout)
+    {
+        const char* emsg = "out must be a writeable C-contiguous "
+            "float64 array of the output shape.";
+        throw invalid_argument(emsg);
+    }
+    double* outdata = static_cast<double*>(PyArray_DATA(pout));
+    NumPyArray_DoublePtr rv(out, outdata);
+    return rv;
+}
+
+
+/// helper for creating numpy array of single precision floats
+NumPyArray_FloatPtr createNumPyFloatArray(int dim, const int* sz)
+{
+    boost::python::object rvobj = newNumPyArray(dim, sz, PyArray_FLOAT);
+    float* rvdata = static_cast<float*>(PyArray_DATA(rvobj.ptr()));
+    NumPyArray_FloatPtr rv(rvobj, rvdata);
+    return rv;
+}
+
+
 /// helper for creating numpy array of integers
 NumPyArray_IntPtr createNumPyIntArray(int dim, const int* sz)
 {
@@ -211,6 +211,12 @@ typedef std::pair<boost::python::object, double*> NumPyArray_DoublePtr;
 /// helper for creating numpy array of doubles
 NumPyArray_DoublePtr createNumPyDoubleArray(int dim, const int* sz);
 
+/// Return a new numpy array of doubles when out is None.  Otherwise check
+/// out is a writeable C-contiguous array of doubles with the shape sz.
+/// Throw invalid_argument for any other out argument.
+NumPyArray_DoublePtr
+useNumPyDoubleArray(::boost::python::object out, int dim, const int* sz);
+
 
 /// template function for converting iterables to numpy array of doubles
 template <class Iter>
@@ -275,6 +281,36 @@ convertToNumPyArray(const ::diffpy::srreal::QuantityType& value)
 }
 
 
+/// Type for numpy array object and a raw pointer to its float data
+typedef std::pair<boost::python::object, float*> NumPyArray_FloatPtr;
+
+/// helper for creating numpy array of single precision floats
+NumPyArray_FloatPtr createNumPyFloatArray(int dim, const int* sz);
+
+
+/// template function for converting iterables to numpy array of floats
+template <class Iter>
+::boost::python::object
+convertToNumPyFloatArray(Iter first, Iter last)
+{
+    int sz = last - first;
+    NumPyArray_FloatPtr ap = createNumPyFloatArray(1, &sz);
+    std::copy(first, last, ap.second);
+    return ap.first;
+}
+
+
+/// convert QuantityType to numpy array of floats or doubles
+inline ::boost::python::object
+convertToNumPyArray(const ::diffpy::srreal::QuantityType& value,
+        bool singleprecision)
+{
+    return singleprecision ?
+        convertToNumPyFloatArray(value.begin(), value.end()) :
+        convertToNumPyArray(value.begin(), value.end());
+}
+
+
 /// Type for numpy array object and a raw pointer to its double data
 typedef std::pair<boost::python::object, int*> NumPyArray_IntPtr;
 
@@ -0,0 +1,451 @@
+/*****************************************************************************
+*
+* diffpy.srreal     by DANSE Diffraction group
+*                   Simon J. L. Billinge
+*                   (c) 2013 Trustees of the Columbia University
+*                   in the City of New York.  All rights reserved.
+*
+* File coded by:    Pavol Juhas
+*
+* See AUTHORS.txt for a list of people who contributed.
+* See LICENSE.txt for license information.
+*
+******************************************************************************
+*
+* DebyeHistogram - pair distances binned by atom-type pair and msd class
+* for an approximate evaluation of the Debye scattering equation.
+*
+*****************************************************************************/
+
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include <limits>
+#include <utility>
+#include <boost/unordered_map.hpp>
+
+#include "srreal_debyehistogram.hpp"
+#include "srreal_pqaccess.hpp"
+#include "srreal_symbols.hpp"
+
+namespace {
+
+using namespace std;
+using namespace diffpy::srreal;
+
+const double fwhmtosigma = 1.0 / (2 * sqrt(2 * M_LN2));
+
+struct CellSums
+{
+    CellSums() : w(0.0), wd(0.0), ws2(0.0)  { }
+    double w;
+    double wd;
+    double ws2;
+};
+
+// cells of one type pair keyed by the msd class and distance bin.
+// The cells are sparse, because every msd class usually spans a narrow
+// range of distances.
+typedef pair<long, int> CellKey;
+typedef boost::unordered_map<CellKey, CellSums> CellBins;
+
+// number of Q-points in a block evaluated by one thread.  This also
+// limits accumulation of rounding errors in the RECURRENCE kernel.
+const int QBLOCKSIZE = 256;
+
+
+// index of the first Q-point where the Gaussian factor exp(a q**2)
+// drops below precision.
+
+int gaussiancutoffindex(double a, double qstep, double precision)
+{
+    if (a >= 0.0 || precision <= 0.0 || qstep <= 0.0)
+    {
+        return numeric_limits<int>::max();
+    }
+    double qcut = sqrt(max(0.0, log(precision) / a));
+    double kqcut = floor(qcut / qstep) + 1;
+    int rv = (kqcut < numeric_limits<int>::max()) ?
+        int(kqcut) : numeric_limits<int>::max();
+    return rv;
+}
+
+
+// SIMD kernel - recurrences for SIMDWIDTH cells evaluated in the lanes
+// of GCC vector types.  The loop body is compiled twice, for the baseline
+// instruction set and for AVX2, and the variant is selected at runtime.
+
+const int SIMDWIDTH = 4;
+
+#ifdef __GNUC__
+
+typedef double v4d __attribute__((vector_size(32)));
+typedef long long v4i __attribute__((vector_size(32)));
+
+// Add the Debye terms of ncells cells to the lane sums acc[kq - kq0].
+// ncells must be a multiple of SIMDWIDTH, padded cells have kqend = kq0.
+
+inline __attribute__((always_inline))
+void simdcellsumsbody(v4d* acc, const double* dist, const double* wscale,
+        const double* a, const int* kqend, int ncells,
+        int kq0, double qstep)
+{
+    const double q0 = kq0 * qstep;
+    for (int c = 0; c < ncells; c += SIMDWIDTH)
+    {
+        v4d twocos, sn, snm1, dwf, dwfratio, dwfratio2;
+        v4i endv;
+        int kqmax = kq0;
+        for (int j = 0; j < SIMDWIDTH; ++j)
+        {
+            const int i = c + j;
+            const double theta = qstep * dist[i];
+            twocos[j] = 2 * cos(theta);
+            sn[j] = sin(q0 * dist[i]);
+            snm1[j] = sin(q0 * dist[i] - theta);
+            dwf[j] = wscale[i] * exp(a[i] * q0 * q0);
+            dwfratio[j] = exp(a[i] * qstep * (2 * q0 + qstep));
+            dwfratio2[j] = exp(2 * a[i] * qstep * qstep);
+            endv[j] = kqend[i];
+            kqmax = max(kqmax, kqend[i]);
+        }
+        v4i kqv = {kq0, kq0, kq0, kq0};
+        const v4i one = {1, 1, 1, 1};
+        for (int kq = kq0; kq < kqmax; ++kq)
+        {
+            // lanes past their Gaussian cutoff add zero
+            const v4i active = (kqv < endv);
+            const v4d term = dwf * sn;
+            acc[kq - kq0] += (v4d)((v4i)(term) & active);
+            const v4d snp1 = twocos * sn - snm1;
+            snm1 = sn;
+            sn = snp1;
+            dwf *= dwfratio;
+            dwfratio *= dwfratio2;
+            kqv += one;
+        }
+    }
+}
+
+
+void simdcellsumsgeneric(v4d* acc, const double* dist,
+        const double* wscale, const double* a, const int* kqend,
+        int ncells, int kq0, double qstep)
+{
+    simdcellsumsbody(acc, dist, wscale, a, kqend, ncells, kq0, qstep);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SRREAL_SIMD_DISPATCH
+
+__attribute__((target("avx2")))
+void simdcellsumsavx2(v4d* acc, const double* dist,
+        const double* wscale, const double* a, const int* kqend,
+        int ncells, int kq0, double qstep)
+{
+    simdcellsumsbody(acc, dist, wscale, a, kqend, ncells, kq0, qstep);
+}
+
+#endif  // defined(__x86_64__) || defined(__i386__)
+
+typedef void (*SimdCellSumsFunction)(v4d*, const double*, const double*,
+        const double*, const int*, int, int, double);
+
+// variant of the SIMD kernel for the running CPU
+
+SimdCellSumsFunction simdcellsumsfunction()
+{
+#ifdef SRREAL_SIMD_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))  return simdcellsumsavx2;
+#endif
+    return simdcellsumsgeneric;
+}
+
+#endif  // __GNUC__
+
+
+int typepairindex(int ntypes, int i, int j)
+{
+    if (i > j)  swap(i, j);
+    int rv = i * ntypes - i * (i - 1) / 2 + (j - i);
+    return rv;
+}
+
+
+class HistogramAccumulator
+{
+    public:
+
+        // constructor
+        HistogramAccumulator(const PeakWidthModel& pwm,
+                const vector<int>& sitetypeindex,
+                const vector<double>& occupancy,
+                int ntypes, double binwidth, double msdstep) :
+            mpwm(pwm), msitetypeindex(sitetypeindex),
+            moccupancy(occupancy), mntypes(ntypes),
+            mbinwidth(binwidth), mmsdstep(msdstep),
+            mbins(ntypes * (ntypes + 1) / 2)
+        { }
+
+        // methods
+        void operator()(const BaseBondGenerator& bnds, int summationscale)
+        {
+            const double dist = bnds.distance();
+            if (dist <= 0.0)  return;
+            const int i0 = bnds.site0();
+            const int i1 = bnds.site1();
+            const double w = summationscale * bnds.multiplicity() *
+                moccupancy[i0] * moccupancy[i1];
+            if (w == 0.0)  return;
+            const double s2 = pow(mpwm.calculate(bnds) * fwhmtosigma, 2);
+            const int k = typepairindex(mntypes,
+                    msitetypeindex[i0], msitetypeindex[i1]);
+            const long m = long(floor(s2 / mmsdstep));
+            const int b = int(dist / mbinwidth);
+            CellSums& c = mbins[k][CellKey(m, b)];
+            c.w += w;
+            c.wd += w * dist;
+            c.ws2 += w * s2;
+        }
+
+        const vector<CellBins>& bins() const  { return mbins; }
+
+    private:
+
+        // data
+        const PeakWidthModel& mpwm;
+        const vector<int>& msitetypeindex;
+        const vector<double>& moccupancy;
+        int mntypes;
+        double mbinwidth;
+        double mmsdstep;
+        vector<CellBins> mbins;
+};
+
+}   // namespace
+
+namespace srrealmodule {
+
+// class DebyeHistogram ------------------------------------------------------
+
+// constructor
+
+DebyeHistogram::DebyeHistogram()
+{ }
+
+// methods
+
+void DebyeHistogram::build(const PairQuantity& pq, const PeakWidthModel& pwm,
+        double binwidth, double msdstep)
+{
+    if (binwidth <= 0.0 || msdstep <= 0.0)
+    {
+        const char* emsg = "binwidth and msdstep must be positive.";
+        throw invalid_argument(emsg);
+    }
+    StructureAdapterConstPtr stru = pq.getStructure();
+    const int cntsites = stru->countSites();
+    vector<int> sitetypeindex;
+    siteTypeIndices(*stru, mtypes, sitetypeindex);
+    vector<double> occupancy(cntsites);
+    for (int i = 0; i < cntsites; ++i)  occupancy[i] = stru->siteOccupancy(i);
+    HistogramAccumulator acc(pwm, sitetypeindex, occupancy,
+            mtypes.size(), binwidth, msdstep);
+    forEachPairContribution(pq, acc);
+    // convert cell sums to weights and mean values.  The cells are
+    // sorted by their keys so that the Debye sums do not depend on
+    // the hash order.
+    const vector<CellBins>& bins = acc.bins();
+    mcells.assign(bins.size(), vector<Cell>());
+    vector< pair<CellKey, const CellSums*> > sorted;
+    for (int k = 0; k < int(bins.size()); ++k)
+    {
+        sorted.clear();
+        CellBins::const_iterator cb = bins[k].begin();
+        for (; cb != bins[k].end(); ++cb)
+        {
+            if (cb->second.w == 0.0)  continue;
+            sorted.push_back(make_pair(cb->first, &(cb->second)));
+        }
+        sort(sorted.begin(), sorted.end());
+        mcells[k].reserve(sorted.size());
+        for (size_t i = 0; i < sorted.size(); ++i)
+        {
+            const CellSums& cs = *(sorted[i].second);
+            Cell c;
+            c.weight = cs.w;
+            c.distance = cs.wd / cs.w;
+            c.sigma2 = cs.ws2 / cs.w;
+            mcells[k].push_back(c);
+        }
+    }
+}
+
+
+int DebyeHistogram::countTypePairs() const
+{
+    int ntypes = mtypes.size();
+    return ntypes * (ntypes + 1) / 2;
+}
+
+
+int DebyeHistogram::typePairIndex(int i, int j) const
+{
+    return typepairindex(mtypes.size(), i, j);
+}
+
+
+int DebyeHistogram::countCells() const
+{
+    int rv = 0;
+    vector< vector<Cell> >::const_iterator ck = mcells.begin();
+    for (; ck != mcells.end(); ++ck)  rv += ck->size();
+    return rv;
+}
+
+
+template <class T>
+void DebyeHistogram::debyeSums(vector< vector<T> >& sums,
+        double qstep, int kqlo, int nq, double precision,
+        DebyeKernel kernel) const
+{
+    sums.assign(mcells.size(), vector<T>(nq, T(0)));
+#ifdef __GNUC__
+    static const SimdCellSumsFunction simdcellsums = simdcellsumsfunction();
+#else
+    // vector types are not available, use the equivalent scalar kernel
+    if (SIMD == kernel)  kernel = RECURRENCE;
+#endif
+    const int kqfirst = max(0, kqlo);
+    const int nblocks = (nq > kqfirst) ?
+        ((nq - kqfirst + QBLOCKSIZE - 1) / QBLOCKSIZE) : 0;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (int b = 0; b < nblocks; ++b)
+    {
+        const int kq0 = kqfirst + b * QBLOCKSIZE;
+        const int kq1 = min(nq, kq0 + QBLOCKSIZE);
+        // block sums are accumulated in double precision and
+        // rounded only once when stored to the output array
+        double sblock[QBLOCKSIZE];
+#ifdef __GNUC__
+        // SIMD kernel data - lane sums and the active cells of a type
+        // pair arranged as structure of arrays
+        v4d acc[QBLOCKSIZE];
+        vector<double> sdist, swscale, sa;
+        vector<int> skqend;
+#endif
+        for (int k = 0; k < int(mcells.size()); ++k)
+        {
+            fill(sblock, sblock + (kq1 - kq0), 0.0);
+#ifdef __GNUC__
+            if (SIMD == kernel)
+            {
+                sdist.clear();
+                swscale.clear();
+                sa.clear();
+                skqend.clear();
+                vector<Cell>::const_iterator c = mcells[k].begin();
+                for (; c != mcells[k].end(); ++c)
+                {
+                    const double a = -0.5 * c->sigma2;
+                    const int kqend = min(kq1,
+                            gaussiancutoffindex(a, qstep, precision));
+                    if (kqend <= kq0)  continue;
+                    sdist.push_back(c->distance);
+                    swscale.push_back(c->weight / c->distance);
+                    sa.push_back(a);
+                    skqend.push_back(kqend);
+                }
+                // padded cells have zero weight and no active Q-points
+                while (skqend.size() % SIMDWIDTH)
+                {
+                    sdist.push_back(1.0);
+                    swscale.push_back(0.0);
+                    sa.push_back(0.0);
+                    skqend.push_back(kq0);
+                }
+                const v4d zero = {0.0, 0.0, 0.0, 0.0};
+                fill(acc, acc + (kq1 - kq0), zero);
+                if (!skqend.empty())
+                {
+                    simdcellsums(acc, &(sdist[0]), &(swscale[0]),
+                            &(sa[0]), &(skqend[0]), skqend.size(),
+                            kq0, qstep);
+                }
+                for (int i = 0; i < kq1 - kq0; ++i)
+                {
+                    sblock[i] = (acc[i][0] + acc[i][1]) +
+                        (acc[i][2] + acc[i][3]);
+                }
+                copy(sblock, sblock + (kq1 - kq0), sums[k].begin() + kq0);
+                continue;
+            }
+#endif
+            vector<Cell>::const_iterator c = mcells[k].begin();
+            for (; c != mcells[k].end(); ++c)
+            {
+                const double a = -0.5 * c->sigma2;
+                const double wscale = c->weight / c->distance;
+                const int kqend = min(kq1,
+                        gaussiancutoffindex(a, qstep, precision));
+                if (kqend <= kq0)  continue;
+                if (DIRECT == kernel)
+                {
+                    for (int kq = kq0; kq < kqend; ++kq)
+                    {
+                        const double q = kq * qstep;
+                        sblock[kq - kq0] += wscale * exp(a * q * q) *
+                            sin(q * c->distance);
+                    }
+                    continue;
+                }
+                // RECURRENCE kernel.
+                // sin((n + 1) t) = 2 cos(t) sin(n t) - sin((n - 1) t)
+                // exp(a (q + dq)**2) = exp(a q**2) * exp(a dq (2 q + dq))
+                const double q0 = kq0 * qstep;
+                const double theta = qstep * c->distance;
+                const double twocos = 2 * cos(theta);
+                double sn = sin(q0 * c->distance);
+                double snm1 = sin(q0 * c->distance - theta);
+                double dwf = wscale * exp(a * q0 * q0);
+                double dwfratio = exp(a * qstep * (2 * q0 + qstep));
+                const double dwfratio2 = exp(2 * a * qstep * qstep);
+                for (int kq = kq0; kq < kqend; ++kq)
+                {
+                    sblock[kq - kq0] += dwf * sn;
+                    const double snp1 = twocos * sn - snm1;
+                    snm1 = sn;
+                    sn = snp1;
+                    dwf *= dwfratio;
+                    dwfratio *= dwfratio2;
+                }
+            }
+            copy(sblock, sblock + (kq1 - kq0), sums[k].begin() + kq0);
+        }
+    }
+}
+
+// explicit instantiations
+
+template void DebyeHistogram::debyeSums(vector< vector<double> >&,
+        double, int, int, double, DebyeKernel) const;
+template void DebyeHistogram::debyeSums(vector< vector<float> >&,
+        double, int, int, double, DebyeKernel) const;
+
+
+double DebyeHistogram::errorBound(double binwidth, double msdstep,
+        double qmax)
+{
+    // second order errors from replacing distances and variances
+    // in a cell with their mean values
+    double rv = pow(qmax * binwidth, 2) / 8 +
+        pow(qmax * qmax * msdstep, 2) / 32;
+    return rv;
+}
+
+}   // namespace srrealmodule
+
+// End of file
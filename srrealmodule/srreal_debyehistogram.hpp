@@ -0,0 +1,131 @@
+/*****************************************************************************
+*
+* diffpy.srreal     by DANSE Diffraction group
+*                   Simon J. L. Billinge
+*                   (c) 2013 Trustees of the Columbia University
+*                   in the City of New York.  All rights reserved.
+*
+* File coded by:    Pavol Juhas
+*
+* See AUTHORS.txt for a list of people who contributed.
+* See LICENSE.txt for license information.
+*
+******************************************************************************
+*
+* DebyeHistogram - pair distances binned by atom-type pair and msd class
+* for an approximate evaluation of the Debye scattering equation.
+*
+*****************************************************************************/
+
+#ifndef SRREAL_DEBYEHISTOGRAM_HPP_INCLUDED
+#define SRREAL_DEBYEHISTOGRAM_HPP_INCLUDED
+
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+
+#include <diffpy/srreal/PairQuantity.hpp>
+#include <diffpy/srreal/PeakWidthModel.hpp>
+
+namespace srrealmodule {
+
+/// Histogram of pair distances for the Debye scattering equation.
+/// Every pair contributes to a cell given by its type pair, msd class
+/// and a distance bin.  The cells keep the total pair weight and the
+/// weighted means of the distance and the Gaussian variance, which
+/// are then used in place of the individual pairs.
+class DebyeHistogram
+{
+    public:
+
+        typedef ::diffpy::srreal::QuantityType QuantityType;
+
+        /// evaluation of the sine terms in debyeSums.
+        /// DIRECT calls sin and exp for every Q-point, RECURRENCE uses
+        /// trigonometric and Gaussian recurrences restarted at every
+        /// Q-block, which avoids the transcendental functions in the
+        /// inner loop.  SIMD runs the RECURRENCE for several cells at
+        /// once in vector registers, with AVX2 selected at runtime when
+        /// the CPU supports it.
+        enum DebyeKernel {DIRECT, RECURRENCE, SIMD};
+
+        // constructor
+        DebyeHistogram();
+
+        // methods
+        /// accumulate all unmasked pairs in the current structure of pq
+        void build(const ::diffpy::srreal::PairQuantity& pq,
+                const ::diffpy::srreal::PeakWidthModel& pwm,
+                double binwidth, double msdstep);
+        /// sorted atom types in the last built structure
+        const std::vector<std::string>& types() const  { return mtypes; }
+        /// number of unique pairs of atom types
+        int countTypePairs() const;
+        /// index of the type pair for type indices i, j
+        int typePairIndex(int i, int j) const;
+        /// number of the histogram cells
+        int countCells() const;
+        /// Debye sums without scattering factors for every type pair,
+        /// sums[k][kq] is a sum of w exp(-s2 q**2 / 2) sin(q d) / d
+        /// at q = kq * qstep for kqlo <= kq < nq.  The Gaussian factor
+        /// is truncated when it drops below precision.  The Q-range is
+        /// split to blocks that are evaluated in parallel when compiled
+        /// with OpenMP.  The sums are always accumulated in double
+        /// precision, T can be float to halve the storage.
+        template <class T>
+        void debyeSums(std::vector< std::vector<T> >& sums,
+                double qstep, int kqlo, int nq, double precision,
+                DebyeKernel kernel=RECURRENCE) const;
+
+        /// approximate upper bound of the relative error of a pair term
+        static double errorBound(double binwidth, double msdstep,
+                double qmax);
+
+    private:
+
+        // types
+        struct Cell
+        {
+            double weight;
+            double distance;
+            double sigma2;
+        };
+
+        // data
+        std::vector<std::string> mtypes;
+        std::vector< std::vector<Cell> > mcells;
+
+};
+
+
+/// Cached DebyeHistogram together with its type-pair Debye sums.
+/// The sums do not include scattering factors, which are applied when
+/// they are combined.  The cache thus stays valid after a change of
+/// the scattering factor table.
+class DebyeHistogramCache
+{
+    public:
+
+        // data
+        /// histogram of the last evaluated structure
+        DebyeHistogram histogram;
+        /// type-pair Debye sums from DebyeHistogram::debyeSums
+        std::vector<DebyeHistogram::QuantityType> sums;
+        /// single precision type-pair sums, used instead of sums
+        /// for calculators in the single precision mode
+        std::vector< std::vector<float> > sumsf;
+        /// identifier of the state used for building the cache,
+        /// empty when invalid
+        std::string key;
+        /// structure adapter used for building the cache
+        boost::weak_ptr<const ::diffpy::srreal::StructureAdapter>
+            structure;
+
+};
+
+typedef boost::shared_ptr<DebyeHistogramCache> DebyeHistogramCachePtr;
+
+}   // namespace srrealmodule
+
+#endif  // SRREAL_DEBYEHISTOGRAM_HPP_INCLUDED
@@ -38,9 +38,13 @@ void wrap_BVSCalculator();
 void wrap_PDFBaseline();
 void wrap_PDFEnvelope();
 void wrap_PDFCalculators();
+void wrap_SineTransform();
 void wrap_BondCalculator();
 void wrap_AtomRadiiTable();
 void wrap_OverlapCalculator();
+void wrap_Trajectory();
+void wrap_MPI();
+void wrap_Pickling();
 
 }   // namespace srrealmodule
 
@@ -66,9 +70,13 @@ BOOST_PYTHON_MODULE(srreal_ext)
     wrap_PDFBaseline();
     wrap_PDFEnvelope();
     wrap_PDFCalculators();
+    wrap_SineTransform();
     wrap_BondCalculator();
     wrap_AtomRadiiTable();
     wrap_OverlapCalculator();
+    wrap_Trajectory();
+    wrap_MPI();
+    wrap_Pickling();
 }
 
 // End of file
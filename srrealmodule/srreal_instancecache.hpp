@@ -0,0 +1,64 @@
+/*****************************************************************************
+*
+* diffpy.srreal     by DANSE Diffraction group
+*                   Simon J. L. Billinge
+*                   (c) 2013 Trustees of the Columbia University
+*                   in the City of New York.  All rights reserved.
+*
+* File coded by:    Pavol Juhas
+*
+* See AUTHORS.txt for a list of people who contributed.
+* See LICENSE.txt for license information.
+*
+******************************************************************************
+*
+* getinstancecache - opaque C++ cache objects kept in the instance
+* dictionary of a wrapped Python object.
+*
+* EmptyCachePickleSuite - pickle suite that restores caches as empty.
+*
+*****************************************************************************/
+
+#ifndef SRREAL_INSTANCECACHE_HPP_INCLUDED
+#define SRREAL_INSTANCECACHE_HPP_INCLUDED
+
+#include <boost/python.hpp>
+#include <boost/shared_ptr.hpp>
+
+namespace srrealmodule {
+
+/// Return cache object of class C stored as cacheattr in the instance
+/// dictionary of self.  Create an empty cache when it does not exist yet.
+/// Class C must be registered with boost python as held by shared_ptr.
+template <class C>
+boost::shared_ptr<C>
+getinstancecache(boost::python::object self, const char* cacheattr)
+{
+    using namespace boost::python;
+    dict d = extract<dict>(self.attr("__dict__"));
+    if (!d.has_key(cacheattr))
+    {
+        boost::shared_ptr<C> cache(new C);
+        d[cacheattr] = object(cache);
+    }
+    boost::shared_ptr<C> rv = extract< boost::shared_ptr<C> >(d[cacheattr]);
+    return rv;
+}
+
+
+/// Caches are always pickled as empty.
+template <class C>
+class EmptyCachePickleSuite : public boost::python::pickle_suite
+{
+    public:
+
+        static boost::python::tuple getinitargs(const C&)
+        {
+            return boost::python::tuple();
+        }
+
+};
+
+}   // namespace srrealmodule
+
+#endif  // SRREAL_INSTANCECACHE_HPP_INCLUDED
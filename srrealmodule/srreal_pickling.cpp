@@ -0,0 +1,187 @@
+/*****************************************************************************
+*
+* diffpy.srreal     by DANSE Diffraction group
+*                   Simon J. L. Billinge
+*                   (c) 2013 Trustees of the Columbia University
+*                   in the City of New York.  All rights reserved.
+*
+* File coded by:    Pavol Juhas
+*
+* See AUTHORS.txt for a list of people who contributed.
+* See LICENSE.txt for license information.
+*
+******************************************************************************
+*
+* Versioned pickle content strings for the boost serialization archives.
+*
+* Layout of the content string:
+*
+*   4 bytes   magic "\0SRP", which cannot start a boost binary archive
+*   1 byte    format version, currently 1
+*   1 byte    codec, 0 for raw archive, 1 for LZ4 block
+*   8 bytes   little-endian archive size, only for the LZ4 codec
+*   ...       archive data
+*
+*****************************************************************************/
+
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef SRREAL_LZ4
+#include <lz4.h>
+#endif
+
+#include "srreal_pickling.hpp"
+
+namespace srrealmodule {
+
+using namespace std;
+
+namespace {
+
+const string PICKLE_MAGIC("\0SRP", 4);
+const char PICKLE_VERSION = 1;
+enum {CODEC_RAW = 0, CODEC_LZ4 = 1};
+const size_t PICKLE_HEADER_SIZE = PICKLE_MAGIC.size() + 2;
+
+// codec selection for new pickles
+string& thepicklecodec()
+{
+    static string codec("raw");
+    return codec;
+}
+
+#ifdef SRREAL_LZ4
+
+// smaller archives are not worth the compression overhead
+const size_t LZ4_MIN_ARCHIVE_SIZE = 4096;
+const size_t LZ4_SIZE_BYTES = 8;
+
+
+void append_size(string& s, size_t sz)
+{
+    for (size_t i = 0; i < LZ4_SIZE_BYTES; ++i)
+    {
+        s.push_back(char((sz >> (8 * i)) & 0xff));
+    }
+}
+
+
+size_t read_size(const string& s, size_t pos)
+{
+    size_t rv = 0;
+    for (size_t i = 0; i < LZ4_SIZE_BYTES; ++i)
+    {
+        rv |= size_t((unsigned char)(s[pos + i])) << (8 * i);
+    }
+    return rv;
+}
+
+#endif  // SRREAL_LZ4
+
+
+void throw_invalid_content()
+{
+    const char* emsg = "Invalid or unsupported pickle content.";
+    throw invalid_argument(emsg);
+}
+
+}   // namespace
+
+
+vector<string> pickle_codecs()
+{
+    vector<string> rv(1, "raw");
+#ifdef SRREAL_LZ4
+    rv.push_back("lz4");
+#endif
+    return rv;
+}
+
+
+const string& get_pickle_codec()
+{
+    return thepicklecodec();
+}
+
+
+void set_pickle_codec(const string& codec)
+{
+    vector<string> codecs = pickle_codecs();
+    codecs.push_back("auto");
+    if (find(codecs.begin(), codecs.end(), codec) == codecs.end())
+    {
+        string emsg = "Unknown or unavailable pickle codec '" + codec + "'.";
+        throw invalid_argument(emsg);
+    }
+    thepicklecodec() = codec;
+}
+
+
+string pickle_pack(const string& archive)
+{
+    string rv = PICKLE_MAGIC;
+    rv.push_back(PICKLE_VERSION);
+#ifdef SRREAL_LZ4
+    const string& codec = get_pickle_codec();
+    const size_t minsize = ("lz4" == codec) ? 0 : LZ4_MIN_ARCHIVE_SIZE;
+    const int maxsize = LZ4_MAX_INPUT_SIZE;
+    if ("raw" != codec && archive.size() >= minsize &&
+            archive.size() <= size_t(maxsize))
+    {
+        const int n = archive.size();
+        string cdata(LZ4_compressBound(n), '\0');
+        int csize = LZ4_compress_default(archive.data(), &(cdata[0]),
+                n, cdata.size());
+        // the "auto" codec uses LZ4 only when it makes content smaller
+        const bool smaller =
+            (csize > 0 && size_t(csize) + LZ4_SIZE_BYTES < archive.size());
+        if (csize > 0 && ("lz4" == codec || smaller))
+        {
+            rv.push_back(char(CODEC_LZ4));
+            append_size(rv, archive.size());
+            rv.append(cdata, 0, csize);
+            return rv;
+        }
+    }
+#endif
+    rv.push_back(char(CODEC_RAW));
+    rv.append(archive);
+    return rv;
+}
+
+
+string pickle_unpack(const string& content)
+{
+    // content without header is an archive from an older version
+    if (0 != content.compare(0, PICKLE_MAGIC.size(), PICKLE_MAGIC))
+    {
+        return content;
+    }
+    if (content.size() < PICKLE_HEADER_SIZE)  throw_invalid_content();
+    const char version = content[PICKLE_MAGIC.size()];
+    const char codec = content[PICKLE_MAGIC.size() + 1];
+    if (version > PICKLE_VERSION)  throw_invalid_content();
+    if (CODEC_RAW == codec)  return content.substr(PICKLE_HEADER_SIZE);
+#ifdef SRREAL_LZ4
+    if (CODEC_LZ4 == codec)
+    {
+        const size_t pos = PICKLE_HEADER_SIZE + LZ4_SIZE_BYTES;
+        if (content.size() < pos)  throw_invalid_content();
+        const size_t n = read_size(content, PICKLE_HEADER_SIZE);
+        if (n > size_t(LZ4_MAX_INPUT_SIZE))  throw_invalid_content();
+        string rv(n, '\0');
+        int dsize = LZ4_decompress_safe(content.data() + pos,
+                n ? &(rv[0]) : NULL, content.size() - pos, n);
+        if (dsize < 0 || size_t(dsize) != n)  throw_invalid_content();
+        return rv;
+    }
+#endif
+    // unknown codec or LZ4 content in a build without LZ4
+    throw_invalid_content();
+    return string();
+}
+
+}   // namespace srrealmodule
+
+// End of file
@@ -14,6 +14,11 @@
 *
 * Pickling support that uses serialization of the libdiffpy classes.
 *
+* The boost serialization archives are wrapped in a versioned pickle
+* content string, which is LZ4-compressed for large archives when built
+* with SRREAL_LZ4.  Content without the version header is loaded as
+* a plain archive from the older pickles.
+*
 *****************************************************************************/
 
 #ifndef SRREAL_PICKLING_HPP_INCLUDED
@@ -22,11 +27,45 @@
 #include <boost/python.hpp>
 #include <string>
 #include <sstream>
+#include <vector>
 
 #include <diffpy/serialization.hpp>
 
 namespace srrealmodule {
 
+/// names of the pickle codecs available in this build, "raw" and "lz4"
+std::vector<std::string> pickle_codecs();
+
+/// codec used for new pickle content, by default "raw"
+const std::string& get_pickle_codec();
+
+/// Select codec for new pickle content.  The "auto" codec compresses
+/// archives of 4 kB and more with LZ4 when that makes them smaller,
+/// "lz4" compresses every archive and "raw" disables compression.
+/// Throw invalid_argument for a codec that is not available.
+void set_pickle_codec(const std::string& codec);
+
+/// wrap boost serialization archive in a versioned pickle content string
+std::string pickle_pack(const std::string& archive);
+
+/// return serialization archive from a pickle content string of any version
+std::string pickle_unpack(const std::string& content);
+
+/// serialize C++ object to a pickle content string
+template <class T>
+std::string pickle_tostring(const T& tobj)
+{
+    return pickle_pack(diffpy::serialization_tostring(tobj));
+}
+
+/// restore C++ object from a pickle content string
+template <class T>
+void pickle_fromstring(T& tobj, const std::string& content)
+{
+    diffpy::serialization_fromstring(tobj, pickle_unpack(content));
+}
+
+
 inline
 void ensure_tuple_length(boost::python::tuple state, const int statelen)
 {
@@ -49,7 +88,7 @@ class SerializationPickleSuite : public boost::python::pickle_suite
         {
             using namespace std;
             const T& tobj = boost::python::extract<const T&>(obj);
-            string content = diffpy::serialization_tostring(tobj);
+            string content = pickle_tostring(tobj);
             boost::python::tuple rv = pickledict ?
                 boost::python::make_tuple(content, obj.attr("__dict__")) :
                 boost::python::make_tuple(content);
@@ -67,7 +106,7 @@ class SerializationPickleSuite : public boost::python::pickle_suite
             ensure_tuple_length(state, statelen);
             // load the C++ object
             string content = extract<string>(state[0]);
-            diffpy::serialization_fromstring(tobj, content);
+            pickle_fromstring(tobj, content);
             // restore the object's __dict__
             if (pickledict)
             {
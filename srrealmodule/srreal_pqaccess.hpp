@@ -0,0 +1,140 @@
+/*****************************************************************************
+*
+* diffpy.srreal     by DANSE Diffraction group
+*                   Simon J. L. Billinge
+*                   (c) 2013 Trustees of the Columbia University
+*                   in the City of New York.  All rights reserved.
+*
+* File coded by:    Pavol Juhas
+*
+* See AUTHORS.txt for a list of people who contributed.
+* See LICENSE.txt for license information.
+*
+******************************************************************************
+*
+* Access to the protected PairQuantity members, which allows to run
+* custom bond sweeps from the wrapper code on the original C++ calculators.
+*
+*****************************************************************************/
+
+#ifndef SRREAL_PQACCESS_HPP_INCLUDED
+#define SRREAL_PQACCESS_HPP_INCLUDED
+
+#include <diffpy/srreal/PairQuantity.hpp>
+#include <diffpy/srreal/BaseBondGenerator.hpp>
+
+namespace srrealmodule {
+
+/// Helper class for calling protected methods of any PairQuantity object.
+/// The class is never instantiated, it only provides member pointers
+/// to the protected PairQuantity methods, which are then applied to
+/// the actual calculator with the usual virtual dispatch.
+class PairQuantityAccess : public ::diffpy::srreal::PairQuantity
+{
+    public:
+
+        typedef ::diffpy::srreal::PairQuantity PairQuantity;
+        typedef ::diffpy::srreal::QuantityType QuantityType;
+        typedef ::diffpy::srreal::BaseBondGenerator BaseBondGenerator;
+
+        static QuantityType& valueOf(PairQuantity& pq)
+        {
+            return pq.*(&PairQuantityAccess::mvalue);
+        }
+
+
+        static void resetValueOf(PairQuantity& pq)
+        {
+            (pq.*(&PairQuantityAccess::resetValue))();
+        }
+
+
+        static void configureBondGeneratorOf(const PairQuantity& pq,
+                BaseBondGenerator& bnds)
+        {
+            (pq.*(&PairQuantityAccess::configureBondGenerator))(bnds);
+        }
+
+
+        static void addPairContributionOf(PairQuantity& pq,
+                const BaseBondGenerator& bnds, int summationscale)
+        {
+            (pq.*(&PairQuantityAccess::addPairContribution))(
+                    bnds, summationscale);
+        }
+
+
+        static void executeParallelMergeOf(PairQuantity& pq,
+                const std::string& pdata)
+        {
+            (pq.*(&PairQuantityAccess::executeParallelMerge))(pdata);
+        }
+
+
+        static void finishValueOf(PairQuantity& pq)
+        {
+            (pq.*(&PairQuantityAccess::finishValue))();
+        }
+
+    private:
+
+        // no instances
+        PairQuantityAccess();
+
+};
+
+
+/// Loop over all unique pairs from the bond generator bnds of the current
+/// structure of pq in the same order as the BASIC evaluator and call
+/// fnc(bnds, summationscale) for every pair that is not masked out.
+/// The bnds range is used as is.  The value of pq is neither reset
+/// nor finished here.
+template <class F>
+void forEachPairContribution(const ::diffpy::srreal::PairQuantity& pq,
+        ::diffpy::srreal::BaseBondGenerator& bnds, F& fnc)
+{
+    const int cntsites = pq.getStructure()->countSites();
+    for (int i0 = 0; i0 < cntsites; ++i0)
+    {
+        bnds.selectAnchorSite(i0);
+        bnds.selectSiteRange(0, i0 + 1);
+        for (bnds.rewind(); !bnds.finished(); bnds.next())
+        {
+            const int i1 = bnds.site1();
+            if (!pq.getPairMask(i0, i1))  continue;
+            const int summationscale = (i0 == i1) ? 1 : 2;
+            fnc(bnds, summationscale);
+        }
+    }
+}
+
+
+/// Same as above for a bond generator configured by pq.
+template <class F>
+void forEachPairContribution(const ::diffpy::srreal::PairQuantity& pq,
+        F& fnc)
+{
+    using namespace ::diffpy::srreal;
+    BaseBondGeneratorPtr bnds = pq.getStructure()->createBondGenerator();
+    PairQuantityAccess::configureBondGeneratorOf(pq, *bnds);
+    forEachPairContribution(pq, *bnds, fnc);
+}
+
+
+/// Replace the evaluator of pq with a new one of the same type.
+/// This discards any history of the OPTIMIZED evaluator after the value
+/// was computed by a custom bond sweep, so that the next eval call starts
+/// from scratch.  A copied calculator also needs a new evaluator, which
+/// would otherwise be shared with the source object.
+inline
+void resetPQEvaluator(::diffpy::srreal::PairQuantity& pq)
+{
+    using namespace ::diffpy::srreal;
+    const PQEvaluatorType tp = pq.getEvaluatorType();
+    pq.setEvaluatorType(BASIC == tp ? OPTIMIZED : BASIC);
+    pq.setEvaluatorType(tp);
+}
+
+}   // namespace srrealmodule
+
+#endif  // SRREAL_PQACCESS_HPP_INCLUDED
@@ -0,0 +1,239 @@
+/*****************************************************************************
+*
+* diffpy.srreal     by DANSE Diffraction group
+*                   Simon J. L. Billinge
+*                   (c) 2013 Trustees of the Columbia University
+*                   in the City of New York.  All rights reserved.
+*
+* File coded by:    Pavol Juhas
+*
+* See AUTHORS.txt for a list of people who contributed.
+* See LICENSE.txt for license information.
+*
+******************************************************************************
+*
+* pqclone - copy method of the wrapped calculators that uses the C++ copy
+* constructor instead of a serialization round-trip.
+*
+* SharedTableRegistry - copy-on-write sharing of lookup tables between
+* the copied calculators.
+*
+*****************************************************************************/
+
+#ifndef SRREAL_PQCOPY_HPP_INCLUDED
+#define SRREAL_PQCOPY_HPP_INCLUDED
+
+#include <boost/python.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <map>
+#include <vector>
+
+#include <diffpy/srreal/PairQuantity.hpp>
+
+#include "srreal_pqaccess.hpp"
+
+namespace srrealmodule {
+
+const char* const doc_PairQuantity_nativecopy = "\
+Return a deep copy of this PairQuantity object.\n\
+The calculator is copied in C++ without serialization.  The copy\n\
+shares the immutable structure adapter and gets its own clones of\n\
+the configurable components such as peak width model.  Lookup tables\n\
+of the built-in classes are shared with the source until one of the\n\
+calculators changes its table, tables of derived Python classes are\n\
+cloned.  Derived Python calculators are copied with copy.copy.\n\
+";
+
+/// Return true if C++ object is an instance of a Python-derived class.
+template <class T>
+bool ispythonderived(const T* p)
+{
+    using boost::python::detail::wrapper_base;
+    return 0 != dynamic_cast<const wrapper_base*>(p);
+}
+
+/// Copy-on-write registry of the lookup tables of type T shared by
+/// copied calculators.  Every entry keeps weak references to the Python
+/// owners of a table in the order of sharing.  The first owner that still
+/// holds the table is its primary owner, whose table object is visible
+/// from Python.  The other owners get a private clone of the unchanged
+/// table in detach, which must be called by the wrapped table mutators
+/// before writing.  The registry is used only with the GIL held.
+template <class T>
+class SharedTableRegistry
+{
+    public:
+
+        // types
+        typedef boost::shared_ptr<T> TablePtr;
+        /// access to the table of a Python owner object
+        struct OwnerAccess
+        {
+            TablePtr (*get)(boost::python::object);
+            void (*set)(boost::python::object, TablePtr);
+            TablePtr (*clone)(const T&);
+        };
+
+        // methods
+        static SharedTableRegistry& instance()
+        {
+            // never deleted, the weak references cannot be released
+            // after the Python interpreter is finalized
+            static SharedTableRegistry* reg = new SharedTableRegistry;
+            return *reg;
+        }
+
+        /// Let the calculator copy cpy share the table of src.
+        /// Tables of Python-derived classes must not be shared, because
+        /// they can change without calling the wrapped mutators.
+        void share(boost::python::object src, boost::python::object cpy,
+                const OwnerAccess& access)
+        {
+            TablePtr p = access.get(src);
+            if (!p)  return;
+            Entry& e = this->validentry(p);
+            if (e.owners.empty())
+            {
+                e.table = p;
+                e.access = access;
+                e.owners.push_back(weakref(src));
+            }
+            e.owners.push_back(weakref(cpy));
+        }
+
+        /// Return true if the owner can expose its table p to Python.
+        /// Otherwise the table is shared and visible from another owner,
+        /// the owner then needs a private clone from its table getter.
+        bool isvisible(const TablePtr& p, boost::python::object owner)
+        {
+            typename Registry::iterator ii = mentries.find(p.get());
+            if (ii == mentries.end())  return true;
+            Entry& e = ii->second;
+            if (e.table.lock() != p || !this->prune(e, p))
+            {
+                mentries.erase(ii);
+                return true;
+            }
+            return e.owners.front()().ptr() == owner.ptr();
+        }
+
+        /// Give private clones of table t to all owners except the primary.
+        void detach(const T& t)
+        {
+            typename Registry::iterator ii = mentries.find(&t);
+            if (ii == mentries.end())  return;
+            Entry e = ii->second;
+            mentries.erase(ii);
+            TablePtr p = e.table.lock();
+            if (p.get() != &t || !this->prune(e, p))  return;
+            // the other owners keep sharing one clone
+            TablePtr q = e.access.clone(t);
+            for (size_t i = 1; i < e.owners.size(); ++i)
+            {
+                e.access.set(e.owners[i](), q);
+            }
+            if (e.owners.size() < 3)  return;
+            Entry& eq = mentries[q.get()];
+            eq.table = q;
+            eq.access = e.access;
+            eq.owners.assign(e.owners.begin() + 1, e.owners.end());
+        }
+
+    private:
+
+        // types
+        struct Entry
+        {
+            boost::weak_ptr<T> table;
+            OwnerAccess access;
+            std::vector<boost::python::object> owners;
+        };
+        typedef std::map<const T*, Entry> Registry;
+
+        // data
+        Registry mentries;
+
+        // methods
+        static boost::python::object weakref(boost::python::object obj)
+        {
+            using namespace boost::python;
+            object wref = import("weakref").attr("ref");
+            return wref(obj);
+        }
+
+        /// Return entry for table p, discard a stale entry for a table
+        /// that was freed at the same address.
+        Entry& validentry(const TablePtr& p)
+        {
+            Entry& e = mentries[p.get()];
+            if (e.table.lock() != p)  e = Entry();
+            return e;
+        }
+
+        /// Remove owners that were deleted or replaced the table p.
+        /// Return true if p is still shared.
+        bool prune(Entry& e, const TablePtr& p)
+        {
+            std::vector<boost::python::object> owners;
+            for (size_t i = 0; i < e.owners.size(); ++i)
+            {
+                boost::python::object o = e.owners[i]();
+                if (o.is_none() || e.access.get(o) != p)  continue;
+                owners.push_back(e.owners[i]);
+            }
+            e.owners.swap(owners);
+            return e.owners.size() > 1;
+        }
+
+};
+
+/// Return the table of a Python owner for its table property getter.
+/// A table shared with the primary owner is replaced with a private clone.
+template <class T>
+boost::shared_ptr<T> getsharedtable(boost::python::object owner,
+        const typename SharedTableRegistry<T>::OwnerAccess& access)
+{
+    SharedTableRegistry<T>& reg = SharedTableRegistry<T>::instance();
+    boost::shared_ptr<T> rv = access.get(owner);
+    if (rv && !reg.isvisible(rv, owner))
+    {
+        rv = access.clone(*rv);
+        access.set(owner, rv);
+    }
+    return rv;
+}
+
+/// Component handler for calculators that have no components to clone.
+inline
+void pqnoclonecomponents(boost::python::object, boost::python::object)  { }
+
+/// Return a copy of Python object pqobj that wraps C++ class T.
+/// Function F is then called with the source and new Python objects
+/// to replace configurable components of the copy with private clones
+/// or shared tables.  Instances of derived Python classes are copied
+/// with copy.copy.
+template <class T, void (*F)(boost::python::object, boost::python::object)>
+boost::python::object pqclone(boost::python::object pqobj)
+{
+    using namespace boost::python;
+    const PyTypeObject* tcls =
+        converter::registered<T>::converters.get_class_object();
+    if (Py_TYPE(pqobj.ptr()) != tcls)
+    {
+        object copy = import("copy").attr("copy");
+        return copy(pqobj);
+    }
+    const T& src = extract<const T&>(pqobj);
+    object rv(src);
+    resetPQEvaluator(extract<T&>(rv)());
+    // shallow copy of the instance dictionary, same as for copy.copy
+    dict d = extract<dict>(rv.attr("__dict__"));
+    d.update(pqobj.attr("__dict__"));
+    F(pqobj, rv);
+    return rv;
+}
+
+}   // namespace srrealmodule
+
+#endif  // SRREAL_PQCOPY_HPP_INCLUDED
@@ -0,0 +1,94 @@
+/*****************************************************************************
+*
+* diffpy.srreal     by DANSE Diffraction group
+*                   Simon J. L. Billinge
+*                   (c) 2013 Trustees of the Columbia University
+*                   in the City of New York.  All rights reserved.
+*
+* File coded by:    Pavol Juhas
+*
+* See AUTHORS.txt for a list of people who contributed.
+* See LICENSE.txt for license information.
+*
+******************************************************************************
+*
+* Batch lookup of scattering factors for several atom types and Q values.
+*
+* sftableowneraccess - access to the shared scattering factor table
+* of ScatteringFactorTableOwner objects.
+*
+*****************************************************************************/
+
+#ifndef SRREAL_SFLOOKUP_HPP_INCLUDED
+#define SRREAL_SFLOOKUP_HPP_INCLUDED
+
+#include <string>
+#include <vector>
+
+#include <diffpy/srreal/ScatteringFactorTable.hpp>
+
+#include "srreal_pqcopy.hpp"
+
+namespace srrealmodule {
+
+/// Fill out[i * nq + k] with the scattering factor of smbls[i] at q[k].
+/// The out array must have space for smbls.size() * nq values.
+inline
+void lookupScatteringFactors(
+        const ::diffpy::srreal::ScatteringFactorTable& sftb,
+        const std::vector<std::string>& smbls,
+        const double* q, int nq, double* out)
+{
+    std::vector<std::string>::const_iterator smbl = smbls.begin();
+    for (; smbl != smbls.end(); ++smbl)
+    {
+        const double* qk = q;
+        const double* qlast = q + nq;
+        for (; qk != qlast; ++qk, ++out)  *out = sftb.lookup(*smbl, *qk);
+    }
+}
+
+// access functions for sharing the table of ScatteringFactorTableOwner
+
+inline
+::diffpy::srreal::ScatteringFactorTablePtr
+getownersftable(boost::python::object owner)
+{
+    using ::diffpy::srreal::ScatteringFactorTableOwner;
+    ScatteringFactorTableOwner& obj =
+        boost::python::extract<ScatteringFactorTableOwner&>(owner);
+    return obj.getScatteringFactorTable();
+}
+
+
+inline
+void setownersftable(boost::python::object owner,
+        ::diffpy::srreal::ScatteringFactorTablePtr tb)
+{
+    using ::diffpy::srreal::ScatteringFactorTableOwner;
+    ScatteringFactorTableOwner& obj =
+        boost::python::extract<ScatteringFactorTableOwner&>(owner);
+    obj.setScatteringFactorTable(tb);
+}
+
+
+inline
+::diffpy::srreal::ScatteringFactorTablePtr
+clonesftable(const ::diffpy::srreal::ScatteringFactorTable& tb)
+{
+    return tb.clone();
+}
+
+
+inline
+const SharedTableRegistry< ::diffpy::srreal::ScatteringFactorTable
+    >::OwnerAccess& sftableowneraccess()
+{
+    static const SharedTableRegistry< ::diffpy::srreal::ScatteringFactorTable
+        >::OwnerAccess rv = {getownersftable, setownersftable, clonesftable};
+    return rv;
+}
+
+}   // namespace srrealmodule
+
+#endif  // SRREAL_SFLOOKUP_HPP_INCLUDED
@@ -0,0 +1,324 @@
+/*****************************************************************************
+*
+* diffpy.srreal     by DANSE Diffraction group
+*                   Simon J. L. Billinge
+*                   (c) 2013 Trustees of the Columbia University
+*                   in the City of New York.  All rights reserved.
+*
+* File coded by:    Pavol Juhas
+*
+* See AUTHORS.txt for a list of people who contributed.
+* See LICENSE.txt for license information.
+*
+******************************************************************************
+*
+* SineTransformPlan - precomputed FFT tables for the discrete sine
+* transform between F(Q) and G(r).
+* SineTransform - cache of SineTransformPlan objects by padded length.
+*
+*****************************************************************************/
+
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+#include <stdexcept>
+
+#include "srreal_sinetransform.hpp"
+
+namespace srrealmodule {
+
+using namespace std;
+
+namespace {
+
+// bit-reversal permutation table for n = 2^nbits points
+void fillbitreversed(vector<int>& rv, int n)
+{
+    int nbits = 0;
+    while ((1 << nbits) < n)  ++nbits;
+    rv.resize(n);
+    for (int i = 0; i < n; ++i)
+    {
+        int r = 0;
+        for (int b = 0; b < nbits; ++b)
+        {
+            r |= ((i >> b) & 1) << (nbits - 1 - b);
+        }
+        rv[i] = r;
+    }
+}
+
+
+// in-place radix-2 FFT of n = 2^k points with twiddles exp(-2 pi i j / n)
+// for j < n / 2
+void fftpow2(complex<double>* a, int n,
+        const vector<int>& bitreversed,
+        const vector< complex<double> >& twiddles)
+{
+    for (int i = 0; i < n; ++i)
+    {
+        const int r = bitreversed[i];
+        if (i < r)  swap(a[i], a[r]);
+    }
+    for (int len = 2; len <= n; len <<= 1)
+    {
+        const int half = len / 2;
+        const int tstep = n / len;
+        for (int i = 0; i < n; i += len)
+        {
+            complex<double>* ai = a + i;
+            for (int j = 0; j < half; ++j)
+            {
+                const complex<double> v = ai[j + half] * twiddles[j * tstep];
+                ai[j + half] = ai[j] - v;
+                ai[j] += v;
+            }
+        }
+    }
+}
+
+}   // namespace
+
+// class SineTransformPlan ---------------------------------------------------
+
+// constructor
+
+SineTransformPlan::SineTransformPlan(int padlen) :
+    mpadlen(padlen), mpowerof2(false), mscratchsize(0)
+{
+    if (padlen < 1)
+    {
+        const char* emsg = "padlen must be positive.";
+        throw invalid_argument(emsg);
+    }
+    const int n = 2 * padlen;
+    mpowerof2 = !(padlen & (padlen - 1));
+    mtwiddles.resize(n);
+    for (int k = 0; k < n; ++k)
+    {
+        mtwiddles[k] = polar(1.0, -2 * M_PI * k / n);
+    }
+    if (mpowerof2)
+    {
+        fillbitreversed(mbitreversed, n);
+        return;
+    }
+    // prime factors of n for the mixed-radix transform
+    int m = n;
+    for (int p = 2; p * p <= m; ++p)
+    {
+        while (m % p == 0)
+        {
+            mfactors.push_back(p);
+            m /= p;
+        }
+    }
+    if (m > 1)  mfactors.push_back(m);
+    // chirp tables for the large factors, equal factors share the tables
+    mchirps.resize(mfactors.size());
+    for (size_t i = 0; i < mfactors.size(); ++i)
+    {
+        const int p = mfactors[i];
+        int scratch = p;
+        if (p > MAXDIRECTRADIX)
+        {
+            bool same = (i > 0 && p == mfactors[i - 1]);
+            mchirps[i] = same ? mchirps[i - 1] : createChirpTables(p);
+            scratch += mchirps[i]->fftlength;
+        }
+        mscratchsize = max(mscratchsize, scratch);
+    }
+}
+
+// methods
+
+void SineTransformPlan::transform(const double* x, int nx, int offset,
+        double scale, double* y, WorkBuffer& work) const
+{
+    assert(offset >= 0 && offset + nx <= mpadlen);
+    const int n = 2 * mpadlen;
+    // fill the odd extension.  The terms at 0 and P are zero.
+    complex<double>* fy;
+    if (mpowerof2)
+    {
+        // fill directly in the bit-reversed order for in-place FFT
+        work.assign(n, 0.0);
+        for (int k = 0; k < nx; ++k)
+        {
+            const int kk = k + offset;
+            if (kk == 0)  continue;
+            work[mbitreversed[kk]] = x[k];
+            work[mbitreversed[n - kk]] = -x[k];
+        }
+        fy = &(work[0]);
+        this->fftradix2(fy);
+    }
+    else
+    {
+        // input, output and scratch space for the largest radix
+        work.assign(2 * n + mscratchsize, 0.0);
+        complex<double>* fx = &(work[0]);
+        for (int k = 0; k < nx; ++k)
+        {
+            const int kk = k + offset;
+            if (kk == 0)  continue;
+            fx[kk] = x[k];
+            fx[n - kk] = -x[k];
+        }
+        fy = fx + n;
+        this->fftmixed(fx, 1, fy, n, 0, fy + n);
+    }
+    // FFT of the odd extension equals -2i times the sine transform
+    for (int j = 0; j < mpadlen; ++j)  y[j] = -0.5 * scale * fy[j].imag();
+}
+
+// private methods
+
+void SineTransformPlan::fftradix2(complex<double>* a) const
+{
+    const int n = 2 * mpadlen;
+    for (int len = 2; len <= n; len <<= 1)
+    {
+        const int half = len / 2;
+        const int tstep = n / len;
+        for (int i = 0; i < n; i += len)
+        {
+            complex<double>* ai = a + i;
+            for (int j = 0; j < half; ++j)
+            {
+                const complex<double> v = ai[j + half] * mtwiddles[j * tstep];
+                ai[j + half] = ai[j] - v;
+                ai[j] += v;
+            }
+        }
+    }
+}
+
+
+// Decimation in time over the factor mfactors[ifactor].  Calculate DFT
+// of n points in[0], in[stride], ... and store them in out[0] ... out[n-1].
+
+void SineTransformPlan::fftmixed(const complex<double>* in, int stride,
+        complex<double>* out, int n, int ifactor,
+        complex<double>* tmp) const
+{
+    if (n == 1)
+    {
+        out[0] = in[0];
+        return;
+    }
+    const int ntotal = 2 * mpadlen;
+    const int p = mfactors[ifactor];
+    const int m = n / p;
+    for (int q = 0; q < p; ++q)
+    {
+        this->fftmixed(in + q * stride, stride * p,
+                out + q * m, m, ifactor + 1, tmp);
+    }
+    // twiddle step for the n-point roots of unity and the p-point roots
+    const int nstep = ntotal / n;
+    const int pstep = ntotal / p;
+    for (int k = 0; k < m; ++k)
+    {
+        for (int q = 0; q < p; ++q)
+        {
+            tmp[q] = out[q * m + k] * mtwiddles[(q * k * nstep) % ntotal];
+        }
+        if (mchirps[ifactor])
+        {
+            dftchirp(*mchirps[ifactor], tmp, tmp + p);
+            for (int s = 0; s < p; ++s)  out[k + s * m] = tmp[s];
+            continue;
+        }
+        for (int s = 0; s < p; ++s)
+        {
+            complex<double> xs = tmp[0];
+            for (int q = 1; q < p; ++q)
+            {
+                xs += tmp[q] * mtwiddles[((q * s) % p) * pstep];
+            }
+            out[k + s * m] = xs;
+        }
+    }
+}
+
+
+SineTransformPlan::ChirpTablesPtr
+SineTransformPlan::createChirpTables(int p)
+{
+    boost::shared_ptr<ChirpTables> ct(new ChirpTables);
+    int L = 1;
+    while (L < 2 * p - 1)  L <<= 1;
+    ct->fftlength = L;
+    fillbitreversed(ct->bitreversed, L);
+    ct->twiddles.resize(L / 2);
+    for (int j = 0; j < L / 2; ++j)
+    {
+        ct->twiddles[j] = polar(1.0, -2 * M_PI * j / L);
+    }
+    // chirp exp(-i pi q^2 / p) with q^2 reduced modulo 2 p for accuracy
+    ct->chirp.resize(p);
+    for (int q = 0; q < p; ++q)
+    {
+        const long long qq = (1LL * q * q) % (2LL * p);
+        ct->chirp[q] = polar(1.0, -M_PI * qq / p);
+    }
+    // FFT of the conjugate chirp wrapped to the cyclic convolution,
+    // scaled by 1 / L for the inverse transform
+    vector< complex<double> >& b = ct->kernelfft;
+    b.assign(L, 0.0);
+    b[0] = conj(ct->chirp[0]) / double(L);
+    for (int q = 1; q < p; ++q)
+    {
+        b[q] = b[L - q] = conj(ct->chirp[q]) / double(L);
+    }
+    fftpow2(&(b[0]), L, ct->bitreversed, ct->twiddles);
+    return ct;
+}
+
+
+// Bluestein DFT of p points in a[0] ... a[p-1], which are overwritten
+// with the result.  tmp must have space for fftlength points.
+
+void SineTransformPlan::dftchirp(const ChirpTables& ct,
+        complex<double>* a, complex<double>* tmp)
+{
+    const int p = ct.chirp.size();
+    const int L = ct.fftlength;
+    for (int q = 0; q < p; ++q)  tmp[q] = a[q] * ct.chirp[q];
+    fill(tmp + p, tmp + L, complex<double>(0.0));
+    fftpow2(tmp, L, ct.bitreversed, ct.twiddles);
+    // inverse FFT as a conjugate of the forward FFT of conjugate values
+    for (int j = 0; j < L; ++j)  tmp[j] = conj(tmp[j] * ct.kernelfft[j]);
+    fftpow2(tmp, L, ct.bitreversed, ct.twiddles);
+    for (int s = 0; s < p; ++s)  a[s] = ct.chirp[s] * conj(tmp[s]);
+}
+
+// class SineTransform -------------------------------------------------------
+
+int SineTransform::padLength(int n)
+{
+    if (n <= 0)  return 0;
+    int rv = 1;
+    while (rv < n)  rv <<= 1;
+    return rv;
+}
+
+
+int SineTransform::gridOffset(double step, double xmin)
+{
+    int rv = int(floor(xmin / step + 0.5));
+    return rv;
+}
+
+
+SineTransform::PlanPtr SineTransform::getPlan(int padlen)
+{
+    PlanPtr& rv = mplans[padlen];
+    if (!rv)  rv.reset(new SineTransformPlan(padlen));
+    return rv;
+}
+
+}   // namespace srrealmodule
+
+// End of file
@@ -0,0 +1,125 @@
+/*****************************************************************************
+*
+* diffpy.srreal     by DANSE Diffraction group
+*                   Simon J. L. Billinge
+*                   (c) 2013 Trustees of the Columbia University
+*                   in the City of New York.  All rights reserved.
+*
+* File coded by:    Pavol Juhas
+*
+* See AUTHORS.txt for a list of people who contributed.
+* See LICENSE.txt for license information.
+*
+******************************************************************************
+*
+* SineTransformPlan - precomputed radix-2 FFT tables for the discrete
+* sine transform between F(Q) and G(r).
+* SineTransform - cache of SineTransformPlan objects by padded length.
+*
+*****************************************************************************/
+
+#ifndef SRREAL_SINETRANSFORM_HPP_INCLUDED
+#define SRREAL_SINETRANSFORM_HPP_INCLUDED
+
+#include <complex>
+#include <map>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+
+namespace srrealmodule {
+
+/// Discrete sine transform of a fixed padded length P.  The transform
+/// is evaluated as a complex FFT of the odd extension of the input to
+/// 2 P points.  Powers of 2 use an in-place radix-2 FFT, other lengths
+/// use a mixed-radix FFT over the prime factors of 2 P.  Small factors
+/// are summed directly and large prime factors use the Bluestein chirp
+/// transform, so that the cost stays O(P log P) for any P.  The plan is
+/// immutable after construction and can be shared by concurrent threads.
+class SineTransformPlan
+{
+    public:
+
+        typedef std::vector< std::complex<double> > WorkBuffer;
+
+        // constructor
+        explicit SineTransformPlan(int padlen);
+
+        // methods
+        /// padded length of the transform
+        int padLength() const  { return mpadlen; }
+        /// y[j] = scale * sum_k x[k] sin(pi (k + offset) j / P) for j < P,
+        /// where offset + nx must not exceed P.  The work buffer can be
+        /// reused among calls to avoid repeated allocations.
+        void transform(const double* x, int nx, int offset, double scale,
+                double* y, WorkBuffer& work) const;
+
+        // constants
+        /// largest prime factor that is transformed by direct summation
+        static const int MAXDIRECTRADIX = 64;
+
+    private:
+
+        // types
+        /// tables for the Bluestein transform of a prime length p,
+        /// which is evaluated as a cyclic convolution of length 2^k
+        struct ChirpTables
+        {
+            int fftlength;
+            std::vector<int> bitreversed;
+            std::vector< std::complex<double> > twiddles;
+            std::vector< std::complex<double> > chirp;
+            std::vector< std::complex<double> > kernelfft;
+        };
+        typedef boost::shared_ptr<const ChirpTables> ChirpTablesPtr;
+
+        // methods
+        void fftradix2(std::complex<double>* a) const;
+        void fftmixed(const std::complex<double>* in, int stride,
+                std::complex<double>* out, int n, int ifactor,
+                std::complex<double>* tmp) const;
+        static ChirpTablesPtr createChirpTables(int p);
+        static void dftchirp(const ChirpTables& ct,
+                std::complex<double>* a, std::complex<double>* tmp);
+
+        // data
+        int mpadlen;
+        bool mpowerof2;
+        std::vector<int> mbitreversed;
+        std::vector<int> mfactors;
+        std::vector<ChirpTablesPtr> mchirps;
+        int mscratchsize;
+        std::vector< std::complex<double> > mtwiddles;
+
+};
+
+
+/// Cache of sine transform plans keyed by the padded length.
+/// The grid step only scales the output and does not need a separate plan.
+class SineTransform
+{
+    public:
+
+        typedef boost::shared_ptr<const SineTransformPlan> PlanPtr;
+
+        // methods
+        /// smallest power of 2 that is not less than n or 0 for n <= 0
+        static int padLength(int n);
+        /// index of the first grid point xmin in a grid from 0 by step
+        static int gridOffset(double step, double xmin);
+        /// cached plan for the padded length padlen
+        PlanPtr getPlan(int padlen);
+        /// number of the cached plans
+        int countPlans() const  { return mplans.size(); }
+        /// remove all cached plans
+        void clearPlans()  { mplans.clear(); }
+
+    private:
+
+        // data
+        std::map<int, PlanPtr> mplans;
+
+};
+
+}   // namespace srrealmodule
+
+#endif  // SRREAL_SINETRANSFORM_HPP_INCLUDED
@@ -0,0 +1,58 @@
+/*****************************************************************************
+*
+* diffpy.srreal     by DANSE Diffraction group
+*                   Simon J. L. Billinge
+*                   (c) 2013 Trustees of the Columbia University
+*                   in the City of New York.  All rights reserved.
+*
+* File coded by:    Pavol Juhas
+*
+* See AUTHORS.txt for a list of people who contributed.
+* See LICENSE.txt for license information.
+*
+******************************************************************************
+*
+* SiteTypeCache - per-site atom type indices and amounts kept for
+* the last structure adapter.
+*
+*****************************************************************************/
+
+#include "srreal_sitetypes.hpp"
+#include "srreal_symbols.hpp"
+
+namespace srrealmodule {
+
+using namespace std;
+using namespace diffpy::srreal;
+
+// class SiteTypeCache -------------------------------------------------------
+
+// methods
+
+void SiteTypeCache::update(const StructureAdapterConstPtr& stru)
+{
+    if (mstructure && (mstructure == stru))  return;
+    this->clear();
+    siteTypeIndices(*stru, mtypes, msitetypeindex);
+    mtypeamounts.assign(mtypes.size(), 0.0);
+    const int cntsites = stru->countSites();
+    for (int i = 0; i < cntsites; ++i)
+    {
+        mtypeamounts[msitetypeindex[i]] +=
+            stru->siteOccupancy(i) * stru->siteMultiplicity(i);
+    }
+    mstructure = stru;
+}
+
+
+void SiteTypeCache::clear()
+{
+    mstructure.reset();
+    mtypes.clear();
+    msitetypeindex.clear();
+    mtypeamounts.clear();
+}
+
+}   // namespace srrealmodule
+
+// End of file
@@ -0,0 +1,72 @@
+/*****************************************************************************
+*
+* diffpy.srreal     by DANSE Diffraction group
+*                   Simon J. L. Billinge
+*                   (c) 2013 Trustees of the Columbia University
+*                   in the City of New York.  All rights reserved.
+*
+* File coded by:    Pavol Juhas
+*
+* See AUTHORS.txt for a list of people who contributed.
+* See LICENSE.txt for license information.
+*
+******************************************************************************
+*
+* SiteTypeCache - per-site atom type indices and amounts kept for
+* the last structure adapter.
+*
+*****************************************************************************/
+
+#ifndef SRREAL_SITETYPES_HPP_INCLUDED
+#define SRREAL_SITETYPES_HPP_INCLUDED
+
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+
+#include <diffpy/srreal/StructureAdapter.hpp>
+
+namespace srrealmodule {
+
+/// Sorted atom types of a structure, the type index of every site and
+/// the total amount of every type.  The data are rebuilt only for a new
+/// structure adapter, so that the type-pair sweeps do not query the
+/// adapter for every site on each call.  Adapters have no change ticker,
+/// thus clear must be called after the same adapter is set again.
+class SiteTypeCache
+{
+    public:
+
+        // methods
+        /// refresh the cached data unless they are valid for stru
+        void update(const ::diffpy::srreal::StructureAdapterConstPtr& stru);
+        /// invalidate the cached data
+        void clear();
+        /// sorted atom types in the structure
+        const std::vector<std::string>& types() const  { return mtypes; }
+        /// index of the atom type for every site
+        const std::vector<int>& siteTypeIndex() const
+        {
+            return msitetypeindex;
+        }
+        /// sum of occupancy times multiplicity for every atom type
+        const std::vector<double>& typeAmounts() const
+        {
+            return mtypeamounts;
+        }
+
+    private:
+
+        // data
+        ::diffpy::srreal::StructureAdapterConstPtr mstructure;
+        std::vector<std::string> mtypes;
+        std::vector<int> msitetypeindex;
+        std::vector<double> mtypeamounts;
+
+};
+
+typedef boost::shared_ptr<SiteTypeCache> SiteTypeCachePtr;
+
+}   // namespace srrealmodule
+
+#endif  // SRREAL_SITETYPES_HPP_INCLUDED
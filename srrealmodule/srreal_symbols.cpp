@@ -0,0 +1,161 @@
+/*****************************************************************************
+*
+* diffpy.srreal     by DANSE Diffraction group
+*                   Simon J. L. Billinge
+*                   (c) 2013 Trustees of the Columbia University
+*                   in the City of New York.  All rights reserved.
+*
+* File coded by:    Pavol Juhas
+*
+* See AUTHORS.txt for a list of people who contributed.
+* See LICENSE.txt for license information.
+*
+******************************************************************************
+*
+* Global table of interned atom type symbols and helpers for resolving
+* the atom types of structure sites to integer indices.
+*
+*****************************************************************************/
+
+#include <Python.h>
+#include <pythread.h>
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+#include "srreal_symbols.hpp"
+
+namespace {
+
+using namespace std;
+
+// deque keeps references to its elements valid when it grows.
+// The table may be used from threads that do not hold the GIL, for
+// example from OpenMP kernels, therefore all access is locked.
+class SymbolTable
+{
+    public:
+
+        SymbolTable() : lock(PyThread_allocate_lock())  { }
+
+        map<string, int> ids;
+        deque<string> symbols;
+        PyThread_type_lock lock;
+
+};
+
+
+SymbolTable& thesymboltable()
+{
+    static SymbolTable tb;
+    return tb;
+}
+
+
+class SymbolTableLock
+{
+    public:
+
+        SymbolTableLock() : mlock(thesymboltable().lock)
+        {
+            PyThread_acquire_lock(mlock, WAIT_LOCK);
+        }
+
+        ~SymbolTableLock()
+        {
+            PyThread_release_lock(mlock);
+        }
+
+    private:
+
+        PyThread_type_lock mlock;
+
+};
+
+
+// comparison of type IDs by their symbols
+
+bool idsymbolless(int id0, int id1)
+{
+    return srrealmodule::internedSymbol(id0) <
+        srrealmodule::internedSymbol(id1);
+}
+
+}   // namespace
+
+namespace srrealmodule {
+
+using namespace std;
+using diffpy::srreal::StructureAdapter;
+
+int internSymbol(const string& smbl)
+{
+    SymbolTableLock locked;
+    SymbolTable& tb = thesymboltable();
+    map<string, int>::iterator ii = tb.ids.lower_bound(smbl);
+    if (ii != tb.ids.end() && ii->first == smbl)  return ii->second;
+    const int rv = tb.symbols.size();
+    tb.ids.insert(ii, make_pair(smbl, rv));
+    tb.symbols.push_back(smbl);
+    return rv;
+}
+
+
+const string& internedSymbol(int id)
+{
+    SymbolTableLock locked;
+    SymbolTable& tb = thesymboltable();
+    if (id < 0 || id >= int(tb.symbols.size()))
+    {
+        ostringstream emsg;
+        emsg << "Unknown atom type ID " << id << '.';
+        throw invalid_argument(emsg.str());
+    }
+    return tb.symbols[id];
+}
+
+
+int countInternedSymbols()
+{
+    SymbolTableLock locked;
+    return thesymboltable().symbols.size();
+}
+
+
+void siteTypeIds(const StructureAdapter& stru, vector<int>& ids)
+{
+    const int cntsites = stru.countSites();
+    ids.resize(cntsites);
+    for (int i = 0; i < cntsites; ++i)
+    {
+        ids[i] = internSymbol(stru.siteAtomType(i));
+    }
+}
+
+
+void siteTypeIndices(const StructureAdapter& stru,
+        vector<string>& types, vector<int>& sitetypeindex)
+{
+    siteTypeIds(stru, sitetypeindex);
+    // unique IDs sorted by their symbols
+    vector<int> uids(sitetypeindex);
+    sort(uids.begin(), uids.end());
+    uids.erase(unique(uids.begin(), uids.end()), uids.end());
+    sort(uids.begin(), uids.end(), idsymbolless);
+    // flat map from the type IDs to type indices
+    vector<int> idtoindex(countInternedSymbols(), -1);
+    types.resize(uids.size());
+    for (int k = 0; k < int(uids.size()); ++k)
+    {
+        idtoindex[uids[k]] = k;
+        types[k] = internedSymbol(uids[k]);
+    }
+    vector<int>::iterator ti = sitetypeindex.begin();
+    for (; ti != sitetypeindex.end(); ++ti)  *ti = idtoindex[*ti];
+}
+
+}   // namespace srrealmodule
+
+// End of file
@@ -0,0 +1,105 @@
+/*****************************************************************************
+*
+* diffpy.srreal     by DANSE Diffraction group
+*                   Simon J. L. Billinge
+*                   (c) 2013 Trustees of the Columbia University
+*                   in the City of New York.  All rights reserved.
+*
+* File coded by:    Pavol Juhas
+*
+* See AUTHORS.txt for a list of people who contributed.
+* See LICENSE.txt for license information.
+*
+******************************************************************************
+*
+* Global table of interned atom type symbols and helpers for resolving
+* the atom types of structure sites to integer indices.
+*
+*****************************************************************************/
+
+#ifndef SRREAL_SYMBOLS_HPP_INCLUDED
+#define SRREAL_SYMBOLS_HPP_INCLUDED
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <diffpy/srreal/StructureAdapter.hpp>
+
+namespace srrealmodule {
+
+/// Return a unique integer ID of the atom type symbol smbl.  The IDs are
+/// assigned in the order of the first use and never change in a process.
+/// The symbol table is locked, so this can be called from any thread.
+int internSymbol(const std::string& smbl);
+
+/// Return the symbol of an interned type ID.
+/// Throw invalid_argument for an unknown ID.
+const std::string& internedSymbol(int id);
+
+/// Return the number of interned symbols.
+int countInternedSymbols();
+
+/// Interned type ID of every site in the structure.
+void siteTypeIds(const ::diffpy::srreal::StructureAdapter& stru,
+        std::vector<int>& ids);
+
+/// Sorted unique atom types in the structure and the index of the type
+/// for every site.  Per-pair loops can then use flat arrays of per-type
+/// data indexed by sitetypeindex.
+void siteTypeIndices(const ::diffpy::srreal::StructureAdapter& stru,
+        std::vector<std::string>& types, std::vector<int>& sitetypeindex);
+
+/// Values of an atom type table indexed by interned type IDs.  Every
+/// value is looked up on the first use of its ID and kept until
+/// the stamp S of the table data changes.
+template <class T, class S>
+class TypeIdCache
+{
+    public:
+
+        // constructor
+        TypeIdCache() : mstamp()  { }
+
+        // methods
+        /// Discard all values unless they were stored for stamp.
+        void validate(const S& stamp)
+        {
+            if (stamp == mstamp)  return;
+            mvalues.clear();
+            mknown.clear();
+            mstamp = stamp;
+        }
+
+        /// Return pointer to the value for type id or NULL if not cached.
+        T* find(int id)
+        {
+            bool known = (0 <= id && id < int(mknown.size()) && mknown[id]);
+            return known ? &(mvalues[id]) : NULL;
+        }
+
+        /// Store value for type id and return reference to the copy.
+        T& insert(int id, const T& value)
+        {
+            if (id >= int(mknown.size()))
+            {
+                mvalues.resize(id + 1);
+                mknown.resize(id + 1, false);
+            }
+            mvalues[id] = value;
+            mknown[id] = true;
+            return mvalues[id];
+        }
+
+    private:
+
+        // data
+        std::vector<T> mvalues;
+        std::vector<bool> mknown;
+        S mstamp;
+
+};
+
+}   // namespace srrealmodule
+
+#endif  // SRREAL_SYMBOLS_HPP_INCLUDED
@@ -0,0 +1,388 @@
+/*****************************************************************************
+*
+* diffpy.srreal     by DANSE Diffraction group
+*                   Simon J. L. Billinge
+*                   (c) 2013 Trustees of the Columbia University
+*                   in the City of New York.  All rights reserved.
+*
+* File coded by:    Pavol Juhas
+*
+* See AUTHORS.txt for a list of people who contributed.
+* See LICENSE.txt for license information.
+*
+******************************************************************************
+*
+* TrajectoryFile - read-only memory map of a binary trajectory file.
+*
+* TrajectoryStructureAdapter - non-periodic StructureAdapter for one frame
+* of a TrajectoryFile.
+*
+*****************************************************************************/
+
+#include <cstring>
+#include <cerrno>
+#include <climits>
+#include <stdexcept>
+#include <algorithm>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <boost/serialization/export.hpp>
+#include <diffpy/serialization.hpp>
+#include <diffpy/srreal/BaseBondGenerator.hpp>
+
+#include "srreal_trajectory.hpp"
+#include "srreal_pqaccess.hpp"
+
+namespace srrealmodule {
+
+using namespace std;
+using namespace diffpy::srreal;
+
+namespace {
+
+const size_t HEADER_SIZE = 24;
+
+
+void throw_invalid_trajectory(const string& filename, const char* reason)
+{
+    string emsg = "Invalid trajectory file '" + filename + "', ";
+    emsg += reason;
+    emsg += '.';
+    throw invalid_argument(emsg);
+}
+
+
+// read little-endian integer of nbytes at p
+long long read_int(const char* p, int nbytes)
+{
+    unsigned long long rv = 0;
+    for (int i = 0; i < nbytes; ++i)
+    {
+        rv |= (unsigned long long)((unsigned char)(p[i])) << (8 * i);
+    }
+    // sign extension for the 4-byte integers
+    const int nbits = 8 * nbytes;
+    if (nbits < 64 && (rv >> (nbits - 1)))  rv |= ~0ULL << nbits;
+    return (long long)(rv);
+}
+
+
+bool is_little_endian()
+{
+    const int one = 1;
+    return 1 == *reinterpret_cast<const char*>(&one);
+}
+
+
+// filename prefixed with the current directory unless absolute
+string absolute_path(const string& filename)
+{
+    if (filename.empty() || '/' == filename[0])  return filename;
+    vector<char> buf(256);
+    while (!getcwd(&(buf[0]), buf.size()))
+    {
+        if (ERANGE != errno)
+        {
+            const char* emsg = "Cannot get the current directory.";
+            throw runtime_error(emsg);
+        }
+        buf.resize(2 * buf.size());
+    }
+    string rv(&(buf[0]));
+    if (rv.empty() || '/' != rv[rv.size() - 1])  rv += '/';
+    rv += filename;
+    return rv;
+}
+
+}   // namespace
+
+// class TrajectoryFile ------------------------------------------------------
+
+const char TrajectoryFile::MAGIC[8] = {'S', 'R', 'T', 'R', 'A', 'J', 0, 0};
+
+TrajectoryFile::TrajectoryFile(const string& filename) :
+    mfilename(absolute_path(filename)), mdata(NULL), msize(0),
+    muiso(NULL), mpositions(NULL), mframecount(0)
+{
+    // the coordinates are mapped as native doubles
+    if (!is_little_endian())
+    {
+        const char* emsg = "Trajectory files require little-endian host.";
+        throw runtime_error(emsg);
+    }
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        string emsg = "Cannot open trajectory file '" + filename + "'.";
+        throw invalid_argument(emsg);
+    }
+    struct stat st;
+    if (0 != fstat(fd, &st))
+    {
+        close(fd);
+        string emsg = "Cannot access trajectory file '" + filename + "'.";
+        throw invalid_argument(emsg);
+    }
+    msize = st.st_size;
+    if (msize < HEADER_SIZE)
+    {
+        close(fd);
+        throw_invalid_trajectory(filename, "file too short");
+    }
+    mdata = mmap(NULL, msize, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == mdata)
+    {
+        mdata = NULL;
+        string emsg = "Cannot map trajectory file '" + filename + "'.";
+        throw invalid_argument(emsg);
+    }
+    // from here on the destructor must release the mapping
+    try
+    {
+        const char* p = static_cast<const char*>(mdata);
+        if (0 != memcmp(p, MAGIC, sizeof(MAGIC)))
+        {
+            throw_invalid_trajectory(filename, "unknown format");
+        }
+        if (VERSION != read_int(p + 8, 4))
+        {
+            throw_invalid_trajectory(filename, "unsupported version");
+        }
+        const long long natoms = read_int(p + 12, 4);
+        const long long nframes = read_int(p + 16, 8);
+        if (natoms < 0 || nframes < 0 || nframes > INT_MAX)
+        {
+            throw_invalid_trajectory(filename, "invalid header");
+        }
+        const size_t offuiso = HEADER_SIZE + SYMBOLSIZE * natoms;
+        const size_t offxyz = offuiso + sizeof(double) * natoms;
+        const size_t framesize = 3 * sizeof(double) * natoms;
+        if (msize < offxyz || (framesize &&
+                    size_t(nframes) > (msize - offxyz) / framesize))
+        {
+            throw_invalid_trajectory(filename, "file too short");
+        }
+        matomtypes.resize(natoms);
+        for (int i = 0; i < natoms; ++i)
+        {
+            const char* smbl = p + HEADER_SIZE + SYMBOLSIZE * i;
+            matomtypes[i].assign(smbl,
+                    find(smbl, smbl + SYMBOLSIZE, '\0'));
+        }
+        muiso = reinterpret_cast<const double*>(p + offuiso);
+        mpositions = reinterpret_cast<const double*>(p + offxyz);
+        mframecount = nframes;
+    }
+    catch (...)
+    {
+        munmap(mdata, msize);
+        throw;
+    }
+}
+
+
+TrajectoryFile::~TrajectoryFile()
+{
+    if (mdata)  munmap(mdata, msize);
+}
+
+
+const string& TrajectoryFile::atomType(int idx) const
+{
+    return matomtypes[idx];
+}
+
+
+double TrajectoryFile::uiso(int idx) const
+{
+    return muiso[idx];
+}
+
+
+const double* TrajectoryFile::framePositions(int frame) const
+{
+    if (frame < 0 || frame >= mframecount)
+    {
+        const char* emsg = "Trajectory frame index out of range.";
+        throw invalid_argument(emsg);
+    }
+    return mpositions + size_t(3) * this->countAtoms() * frame;
+}
+
+// class TrajectoryStructureAdapter ------------------------------------------
+
+TrajectoryStructureAdapter::TrajectoryStructureAdapter() : mframe(0)
+{ }
+
+
+TrajectoryStructureAdapter::TrajectoryStructureAdapter(
+        TrajectoryFilePtr trj, int frame) : mtrj(trj), mframe(0)
+{
+    const int n = mtrj->countAtoms();
+    mpositions.resize(n);
+    muij.resize(n);
+    for (int i = 0; i < n; ++i)
+    {
+        R3::Matrix& U = muij[i];
+        for (int k = 0; k < R3::Ndim; ++k)
+        {
+            for (int l = 0; l < R3::Ndim; ++l)  U(k, l) = 0.0;
+            U(k, k) = mtrj->uiso(i);
+        }
+    }
+    this->setFrame(frame);
+}
+
+
+BaseBondGeneratorPtr TrajectoryStructureAdapter::createBondGenerator() const
+{
+    BaseBondGeneratorPtr bnds(new BaseBondGenerator(shared_from_this()));
+    return bnds;
+}
+
+
+int TrajectoryStructureAdapter::countSites() const
+{
+    return mpositions.size();
+}
+
+
+const string& TrajectoryStructureAdapter::siteAtomType(int idx) const
+{
+    return mtrj->atomType(idx);
+}
+
+
+const R3::Vector&
+TrajectoryStructureAdapter::siteCartesianPosition(int idx) const
+{
+    return mpositions[idx];
+}
+
+
+bool TrajectoryStructureAdapter::siteAnisotropy(int idx) const
+{
+    return false;
+}
+
+
+const R3::Matrix& TrajectoryStructureAdapter::siteCartesianUij(int idx) const
+{
+    return muij[idx];
+}
+
+
+int TrajectoryStructureAdapter::countFrames() const
+{
+    return mtrj ? mtrj->countFrames() : 0;
+}
+
+
+void TrajectoryStructureAdapter::setFrame(int frame)
+{
+    if (!mtrj)
+    {
+        const char* emsg = "Trajectory file is not open.";
+        throw invalid_argument(emsg);
+    }
+    const double* xyz = mtrj->framePositions(frame);
+    vector<R3::Vector>::iterator ri = mpositions.begin();
+    for (; ri != mpositions.end(); ++ri, xyz += R3::Ndim)
+    {
+        copy(xyz, xyz + R3::Ndim, ri->begin());
+    }
+    mframe = frame;
+}
+
+
+void TrajectoryStructureAdapter::openFile(const string& filename)
+{
+    TrajectoryFilePtr trj(new TrajectoryFile(filename));
+    TrajectoryStructureAdapter adpt(trj);
+    mtrj.swap(adpt.mtrj);
+    mpositions.swap(adpt.mpositions);
+    muij.swap(adpt.muij);
+    mframe = adpt.mframe;
+}
+
+// evalFrames ----------------------------------------------------------------
+
+namespace {
+
+class FramePairSum
+{
+    public:
+
+        explicit FramePairSum(PairQuantity& pq) : mpq(pq)  { }
+
+        void operator()(const BaseBondGenerator& bnds, int summationscale)
+        {
+            PairQuantityAccess::addPairContributionOf(
+                    mpq, bnds, summationscale);
+        }
+
+    private:
+
+        PairQuantity& mpq;
+
+};
+
+}   // namespace
+
+
+QuantityType evalFrames(PairQuantity& pq,
+        TrajectoryStructureAdapterPtr adpt,
+        int start, int stop, int stride)
+{
+    if (stride <= 0)
+    {
+        const char* emsg = "Frame stride must be positive.";
+        throw invalid_argument(emsg);
+    }
+    stop = min(stop, adpt->countFrames());
+    if (start < 0 || start >= stop)
+    {
+        const char* emsg = "Empty or invalid range of frames.";
+        throw invalid_argument(emsg);
+    }
+    // a single working copy of the adapter is moved through the frames
+    TrajectoryStructureAdapterPtr fadpt(
+            new TrajectoryStructureAdapter(*adpt));
+    fadpt->setFrame(start);
+    pq.setStructure(fadpt);
+    QuantityType& value = PairQuantityAccess::valueOf(pq);
+    const size_t nvalue = value.size();
+    FramePairSum fsum(pq);
+    int count = 0;
+    for (int frame = start; frame < stop; frame += stride, ++count)
+    {
+        fadpt->setFrame(frame);
+        forEachPairContribution(pq, fsum);
+        if (value.size() != nvalue)
+        {
+            const char* emsg = "Calculated values change length "
+                "between frames, cannot average.";
+            throw invalid_argument(emsg);
+        }
+    }
+    // the finished value is an affine function of the pair sums, thus
+    // finishing the mean sum gives the mean of the per-frame results
+    QuantityType::iterator xi = value.begin();
+    for (; xi != value.end(); ++xi)  *xi /= count;
+    PairQuantityAccess::finishValueOf(pq);
+    resetPQEvaluator(pq);
+    return pq.value();
+}
+
+}   // namespace srrealmodule
+
+// Serialization -------------------------------------------------------------
+
+BOOST_CLASS_EXPORT(srrealmodule::TrajectoryStructureAdapter)
+
+// End of file
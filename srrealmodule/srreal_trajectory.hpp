@@ -0,0 +1,174 @@
+/*****************************************************************************
+*
+* diffpy.srreal     by DANSE Diffraction group
+*                   Simon J. L. Billinge
+*                   (c) 2013 Trustees of the Columbia University
+*                   in the City of New York.  All rights reserved.
+*
+* File coded by:    Pavol Juhas
+*
+* See AUTHORS.txt for a list of people who contributed.
+* See LICENSE.txt for license information.
+*
+******************************************************************************
+*
+* TrajectoryFile - read-only memory map of a binary trajectory file.
+*
+* TrajectoryStructureAdapter - non-periodic StructureAdapter for one frame
+* of a TrajectoryFile.
+*
+* Layout of the trajectory file, all values in little-endian byte order:
+*
+*   8 bytes           magic "SRTRAJ\0\0"
+*   int32             format version, currently 1
+*   int32             number of atoms N
+*   int64             number of frames M
+*   N * 8 bytes       atom type symbols padded with NUL characters
+*   N * float64       isotropic displacement parameters Uiso
+*   M * N * 3 float64 cartesian coordinates for every frame and atom
+*
+*****************************************************************************/
+
+#ifndef SRREAL_TRAJECTORY_HPP_INCLUDED
+#define SRREAL_TRAJECTORY_HPP_INCLUDED
+
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/serialization/base_object.hpp>
+#include <boost/serialization/split_member.hpp>
+
+#include <diffpy/srreal/StructureAdapter.hpp>
+#include <diffpy/srreal/PairQuantity.hpp>
+
+namespace srrealmodule {
+
+/// Read-only memory map of a binary trajectory file.
+class TrajectoryFile : boost::noncopyable
+{
+    public:
+
+        // constructor
+        /// map the file, raise invalid_argument when it cannot be opened
+        /// and mapped or for invalid content
+        explicit TrajectoryFile(const std::string& filename);
+        ~TrajectoryFile();
+
+        // methods
+        /// absolute path of the file, which is kept in the pickles
+        const std::string& filename() const  { return mfilename; }
+        int countAtoms() const  { return matomtypes.size(); }
+        int countFrames() const  { return mframecount; }
+        const std::string& atomType(int idx) const;
+        double uiso(int idx) const;
+        /// pointer to 3N cartesian coordinates of the specified frame
+        const double* framePositions(int frame) const;
+
+        // constants
+        static const char MAGIC[8];
+        static const int VERSION = 1;
+        static const int SYMBOLSIZE = 8;
+
+    private:
+
+        // data
+        std::string mfilename;
+        void* mdata;
+        size_t msize;
+        std::vector<std::string> matomtypes;
+        const double* muiso;
+        const double* mpositions;
+        int mframecount;
+
+};
+
+typedef boost::shared_ptr<TrajectoryFile> TrajectoryFilePtr;
+
+
+/// Non-periodic structure adapter for a frame of a trajectory file.
+/// Selecting a frame only refreshes the site positions from the mapped
+/// coordinates, the file is neither read nor parsed again.
+class TrajectoryStructureAdapter :
+    public ::diffpy::srreal::StructureAdapter
+{
+    public:
+
+        // constructors
+        TrajectoryStructureAdapter();
+        TrajectoryStructureAdapter(TrajectoryFilePtr trj, int frame=0);
+
+        // methods - overloaded
+        virtual ::diffpy::srreal::BaseBondGeneratorPtr
+            createBondGenerator() const;
+        virtual int countSites() const;
+        virtual const std::string& siteAtomType(int idx) const;
+        virtual const ::diffpy::srreal::R3::Vector&
+            siteCartesianPosition(int idx) const;
+        virtual bool siteAnisotropy(int idx) const;
+        virtual const ::diffpy::srreal::R3::Matrix&
+            siteCartesianUij(int idx) const;
+
+        // methods - own
+        const TrajectoryFilePtr& getTrajectoryFile() const  { return mtrj; }
+        int countFrames() const;
+        int getFrame() const  { return mframe; }
+        void setFrame(int frame);
+
+    private:
+
+        // data
+        TrajectoryFilePtr mtrj;
+        int mframe;
+        std::vector< ::diffpy::srreal::R3::Vector > mpositions;
+        std::vector< ::diffpy::srreal::R3::Matrix > muij;
+
+        // methods
+        void openFile(const std::string& filename);
+
+        // serialization keeps only the file name and the frame index
+        friend class boost::serialization::access;
+
+        template<class Archive>
+            void save(Archive& ar, const unsigned int version) const
+        {
+            using boost::serialization::base_object;
+            ar & base_object<StructureAdapter>(*this);
+            std::string filename = mtrj ? mtrj->filename() : "";
+            ar & filename & mframe;
+        }
+
+        template<class Archive>
+            void load(Archive& ar, const unsigned int version)
+        {
+            using boost::serialization::base_object;
+            ar & base_object<StructureAdapter>(*this);
+            std::string filename;
+            int frame;
+            ar & filename & frame;
+            this->openFile(filename);
+            this->setFrame(frame);
+        }
+
+        BOOST_SERIALIZATION_SPLIT_MEMBER()
+
+};
+
+typedef boost::shared_ptr<TrajectoryStructureAdapter>
+    TrajectoryStructureAdapterPtr;
+
+
+/// Evaluate pq for frames in range(start, stop, stride) of adpt and
+/// return its value finished from the mean of per-frame pair sums.
+/// The pq calculator is set up for the first frame and keeps a copy of
+/// adpt moved to the last frame, adpt itself is not changed.  Raise
+/// invalid_argument for an empty frame range or when the length of
+/// the values changes between frames.
+::diffpy::srreal::QuantityType
+evalFrames(::diffpy::srreal::PairQuantity& pq,
+        TrajectoryStructureAdapterPtr adpt,
+        int start, int stop, int stride);
+
+}   // namespace srrealmodule
+
+#endif  // SRREAL_TRAJECTORY_HPP_INCLUDED
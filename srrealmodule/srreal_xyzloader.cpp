@@ -0,0 +1,399 @@
+/*****************************************************************************
+*
+* diffpy.srreal     by DANSE Diffraction group
+*                   Simon J. L. Billinge
+*                   (c) 2013 Trustees of the Columbia University
+*                   in the City of New York.  All rights reserved.
+*
+* File coded by:    Pavol Juhas
+*
+* See AUTHORS.txt for a list of people who contributed.
+* See LICENSE.txt for license information.
+*
+******************************************************************************
+*
+* XYZStructureAdapter - non-periodic StructureAdapter with atoms stored
+* in C++ arrays.
+*
+* loadXYZ - fast loader of XYZ and extended XYZ files.  The whole file
+* is read to a memory buffer in one call and parsed in place.
+*
+*****************************************************************************/
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <locale.h>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#ifdef __APPLE__
+#include <xlocale.h>
+#endif
+
+#include <boost/serialization/export.hpp>
+#include <diffpy/serialization.hpp>
+#include <diffpy/srreal/BaseBondGenerator.hpp>
+
+#include "srreal_xyzloader.hpp"
+
+namespace srrealmodule {
+
+using namespace std;
+using namespace diffpy::srreal;
+
+// class XYZStructureAdapter -------------------------------------------------
+
+BaseBondGeneratorPtr XYZStructureAdapter::createBondGenerator() const
+{
+    BaseBondGeneratorPtr bnds(new BaseBondGenerator(shared_from_this()));
+    return bnds;
+}
+
+
+int XYZStructureAdapter::countSites() const
+{
+    return mpositions.size();
+}
+
+
+const string& XYZStructureAdapter::siteAtomType(int idx) const
+{
+    return matomtypes[idx];
+}
+
+
+const R3::Vector& XYZStructureAdapter::siteCartesianPosition(int idx) const
+{
+    return mpositions[idx];
+}
+
+
+double XYZStructureAdapter::siteOccupancy(int idx) const
+{
+    return moccupancies[idx];
+}
+
+
+bool XYZStructureAdapter::siteAnisotropy(int idx) const
+{
+    return false;
+}
+
+
+const R3::Matrix& XYZStructureAdapter::siteCartesianUij(int idx) const
+{
+    return muij[idx];
+}
+
+
+void XYZStructureAdapter::addSite(const string& smbl,
+        double x, double y, double z, double uiso, double occupancy)
+{
+    matomtypes.push_back(smbl);
+    mpositions.push_back(R3::Vector());
+    R3::Vector& r = mpositions.back();
+    r[0] = x;
+    r[1] = y;
+    r[2] = z;
+    muij.push_back(R3::Matrix());
+    R3::Matrix& U = muij.back();
+    for (int k = 0; k < R3::Ndim; ++k)
+    {
+        for (int l = 0; l < R3::Ndim; ++l)  U(k, l) = 0.0;
+        U(k, k) = uiso;
+    }
+    muiso.push_back(uiso);
+    moccupancies.push_back(occupancy);
+}
+
+
+void XYZStructureAdapter::reserve(int n)
+{
+    matomtypes.reserve(n);
+    mpositions.reserve(n);
+    muij.reserve(n);
+    muiso.reserve(n);
+    moccupancies.reserve(n);
+}
+
+// loadXYZ -------------------------------------------------------------------
+
+namespace {
+
+typedef pair<const char*, const char*> Token;
+
+/// C numeric locale for strtod_l, independent of the global locale.
+/// Created once and kept for the lifetime of the module.
+locale_t cnumericlocale()
+{
+    static locale_t loc = newlocale(LC_NUMERIC_MASK, "C", (locale_t) 0);
+    if (!loc)
+    {
+        const char* emsg = "Cannot create the C numeric locale.";
+        throw runtime_error(emsg);
+    }
+    return loc;
+}
+
+/// column indices of the atom data, negative for absent columns.
+/// Plain XYZ files have only the species and position columns.
+struct XYZColumns
+{
+    XYZColumns() : species(0), pos(1), uiso(-1), occupancy(-1)  { }
+    int species;
+    int pos;
+    int uiso;
+    int occupancy;
+};
+
+
+class XYZParser
+{
+    public:
+
+        XYZParser(const string& filename, const string& content) :
+            mfilename(filename), mp(content.c_str()),
+            mend(content.c_str() + content.size()),
+            mlineno(0), mncolumns(0), mlocale(cnumericlocale())
+        { }
+
+
+        XYZStructureAdapterPtr parse()
+        {
+            Token line;
+            // skip any blank lines before the atom count
+            do
+            {
+                if (!this->nextLine(line))  this->fail("missing atom count");
+                this->split(line);
+            } while (mtokens.empty());
+            const int natoms = this->parseCount();
+            if (!this->nextLine(line))  this->fail("missing comment line");
+            XYZColumns cols;
+            this->parseProperties(line, cols);
+            XYZStructureAdapterPtr adpt(new XYZStructureAdapter);
+            adpt->reserve(natoms);
+            string smbl;
+            for (int i = 0; i < natoms; ++i)
+            {
+                if (!this->nextLine(line))  this->fail("missing atom lines");
+                this->split(line);
+                const int ntk = mtokens.size();
+                if (ntk < 4 || ntk < mncolumns ||
+                        ntk <= cols.species || ntk < cols.pos + 3)
+                {
+                    this->fail("too few columns");
+                }
+                const Token& tks = mtokens[cols.species];
+                smbl.assign(tks.first, tks.second);
+                const double x = this->parseDouble(cols.pos);
+                const double y = this->parseDouble(cols.pos + 1);
+                const double z = this->parseDouble(cols.pos + 2);
+                // Uiso and occupancy columns exist only in extended XYZ,
+                // where every line has all mncolumns of Properties
+                const double uiso = (cols.uiso >= 0) ?
+                    this->parseDouble(cols.uiso) : 0.0;
+                const double occ = (cols.occupancy >= 0) ?
+                    this->parseDouble(cols.occupancy) : 1.0;
+                adpt->addSite(smbl, x, y, z, uiso, occ);
+            }
+            return adpt;
+        }
+
+    private:
+
+        // data
+        const string& mfilename;
+        const char* mp;
+        const char* mend;
+        int mlineno;
+        int mncolumns;
+        vector<Token> mtokens;
+        locale_t mlocale;
+
+        // methods
+
+        void fail(const char* reason) const
+        {
+            ostringstream emsg;
+            emsg << mfilename << ':' << mlineno <<
+                ": invalid XYZ content, " << reason << '.';
+            throw invalid_argument(emsg.str());
+        }
+
+
+        bool nextLine(Token& line)
+        {
+            if (mp >= mend)  return false;
+            const char* eol = static_cast<const char*>(
+                    memchr(mp, '\n', mend - mp));
+            if (!eol)  eol = mend;
+            line.first = mp;
+            line.second = eol;
+            mp = (eol < mend) ? eol + 1 : mend;
+            ++mlineno;
+            return true;
+        }
+
+
+        void split(const Token& line)
+        {
+            mtokens.clear();
+            const char* p = line.first;
+            while (true)
+            {
+                while (p < line.second && isspace((unsigned char)(*p)))  ++p;
+                if (p >= line.second)  break;
+                const char* q = p;
+                while (q < line.second && !isspace((unsigned char)(*q)))  ++q;
+                mtokens.push_back(Token(p, q));
+                p = q;
+            }
+        }
+
+
+        /// number of lines after the current one
+        long countRemainingLines() const
+        {
+            if (mp >= mend)  return 0;
+            long rv = count(mp, mend, '\n');
+            if ('\n' != mend[-1])  ++rv;
+            return rv;
+        }
+
+
+        /// Parse the atom count, which must leave room for the comment
+        /// line and one line per atom in the remaining content.
+        int parseCount()
+        {
+            char* eptr;
+            const char* p = mtokens[0].first;
+            long n = strtol(p, &eptr, 10);
+            if (mtokens.size() != 1 || eptr != mtokens[0].second || n < 0)
+            {
+                this->fail("invalid atom count");
+            }
+            if (n > this->countRemainingLines() - 1)
+            {
+                this->fail("atom count exceeds the number of lines");
+            }
+            return n;
+        }
+
+
+        double parseDouble(int idx)
+        {
+            const Token& tk = mtokens[idx];
+            // tokens are followed by a space or the terminating null
+            // of the content buffer, where strtod_l stops
+            char* eptr;
+            double rv = strtod_l(tk.first, &eptr, mlocale);
+            // the whole token must be consumed by the number
+            if (eptr != tk.second || tk.first == tk.second)
+            {
+                this->fail("invalid number");
+            }
+            return rv;
+        }
+
+
+        /// Set column indices from the Properties key in extended XYZ
+        /// comment line.  Return false for a plain XYZ comment.
+        bool parseProperties(const Token& line, XYZColumns& cols)
+        {
+            static const char key[] = "Properties=";
+            const size_t keylen = sizeof(key) - 1;
+            const char* p = line.first;
+            for (; p + keylen <= line.second; ++p)
+            {
+                bool atstart = (p == line.first ||
+                        isspace((unsigned char)(p[-1])));
+                if (atstart && 0 == strncmp(p, key, keylen))  break;
+            }
+            if (p + keylen > line.second)  return false;
+            p += keylen;
+            const char* q = p;
+            if (q < line.second && '"' == *q)
+            {
+                q = ++p;
+                while (q < line.second && '"' != *q)  ++q;
+            }
+            else
+            {
+                while (q < line.second && !isspace((unsigned char)(*q)))  ++q;
+            }
+            // split name:type:count triples
+            vector<string> words;
+            istringstream fields(string(p, q));
+            string w;
+            while (getline(fields, w, ':'))  words.push_back(w);
+            if (words.empty() || words.size() % 3)
+            {
+                this->fail("invalid Properties");
+            }
+            cols.species = cols.pos = cols.uiso = cols.occupancy = -1;
+            int column = 0;
+            for (size_t i = 0; i < words.size(); i += 3)
+            {
+                const string& name = words[i];
+                const int count = atoi(words[i + 2].c_str());
+                if (count <= 0)  this->fail("invalid Properties");
+                if ("species" == name && 1 == count)  cols.species = column;
+                else if ("pos" == name && 3 == count)  cols.pos = column;
+                else if (("Uiso" == name || "uiso" == name) && 1 == count)
+                {
+                    cols.uiso = column;
+                }
+                else if (("occupancy" == name || "occ" == name) &&
+                        1 == count)
+                {
+                    cols.occupancy = column;
+                }
+                column += count;
+            }
+            if (cols.species < 0 || cols.pos < 0)
+            {
+                this->fail("Properties without species or pos");
+            }
+            mncolumns = column;
+            return true;
+        }
+
+};
+
+}   // namespace
+
+
+XYZStructureAdapterPtr loadXYZ(const string& filename)
+{
+    ifstream fp(filename.c_str(), ios::in | ios::binary);
+    if (!fp)
+    {
+        string emsg = "Cannot open XYZ file '" + filename + "'.";
+        throw invalid_argument(emsg);
+    }
+    fp.seekg(0, ios::end);
+    const streamoff sz = fp.tellg();
+    string content(max(sz, streamoff(0)), '\0');
+    fp.seekg(0, ios::beg);
+    if (!content.empty())  fp.read(&(content[0]), content.size());
+    if (!fp || sz < 0)
+    {
+        string emsg = "Cannot read XYZ file '" + filename + "'.";
+        throw invalid_argument(emsg);
+    }
+    XYZParser parser(filename, content);
+    return parser.parse();
+}
+
+}   // namespace srrealmodule
+
+// Serialization -------------------------------------------------------------
+
+BOOST_CLASS_EXPORT(srrealmodule::XYZStructureAdapter)
+
+// End of file
@@ -0,0 +1,131 @@
+/*****************************************************************************
+*
+* diffpy.srreal     by DANSE Diffraction group
+*                   Simon J. L. Billinge
+*                   (c) 2013 Trustees of the Columbia University
+*                   in the City of New York.  All rights reserved.
+*
+* File coded by:    Pavol Juhas
+*
+* See AUTHORS.txt for a list of people who contributed.
+* See LICENSE.txt for license information.
+*
+******************************************************************************
+*
+* XYZStructureAdapter - non-periodic StructureAdapter with atoms stored
+* in C++ arrays.
+*
+* loadXYZ - fast loader of XYZ and extended XYZ files.
+*
+*****************************************************************************/
+
+#ifndef SRREAL_XYZLOADER_HPP_INCLUDED
+#define SRREAL_XYZLOADER_HPP_INCLUDED
+
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/serialization/base_object.hpp>
+#include <boost/serialization/split_member.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
+
+#include <diffpy/srreal/StructureAdapter.hpp>
+
+namespace srrealmodule {
+
+/// Non-periodic structure adapter for a list of atoms with isotropic
+/// displacement parameters and fractional occupancies.
+class XYZStructureAdapter : public ::diffpy::srreal::StructureAdapter
+{
+    public:
+
+        // methods - overloaded
+        virtual ::diffpy::srreal::BaseBondGeneratorPtr
+            createBondGenerator() const;
+        virtual int countSites() const;
+        virtual const std::string& siteAtomType(int idx) const;
+        virtual const ::diffpy::srreal::R3::Vector&
+            siteCartesianPosition(int idx) const;
+        virtual double siteOccupancy(int idx) const;
+        virtual bool siteAnisotropy(int idx) const;
+        virtual const ::diffpy::srreal::R3::Matrix&
+            siteCartesianUij(int idx) const;
+
+        // methods - own
+        /// append atom site
+        void addSite(const std::string& smbl,
+                double x, double y, double z,
+                double uiso, double occupancy);
+        /// allocate storage for n sites
+        void reserve(int n);
+
+    private:
+
+        // data
+        std::vector<std::string> matomtypes;
+        std::vector< ::diffpy::srreal::R3::Vector > mpositions;
+        std::vector< ::diffpy::srreal::R3::Matrix > muij;
+        std::vector<double> muiso;
+        std::vector<double> moccupancies;
+
+        // serialization stores flat arrays of the site values
+        friend class boost::serialization::access;
+
+        template<class Archive>
+            void save(Archive& ar, const unsigned int version) const
+        {
+            using boost::serialization::base_object;
+            ar & base_object<StructureAdapter>(*this);
+            std::vector<double> xyz;
+            xyz.reserve(3 * mpositions.size());
+            for (size_t i = 0; i < mpositions.size(); ++i)
+            {
+                const ::diffpy::srreal::R3::Vector& r = mpositions[i];
+                for (int k = 0; k < ::diffpy::srreal::R3::Ndim; ++k)
+                {
+                    xyz.push_back(r[k]);
+                }
+            }
+            ar & matomtypes & xyz & muiso & moccupancies;
+        }
+
+        template<class Archive>
+            void load(Archive& ar, const unsigned int version)
+        {
+            using boost::serialization::base_object;
+            ar & base_object<StructureAdapter>(*this);
+            std::vector<std::string> atomtypes;
+            std::vector<double> xyz, uiso, occupancies;
+            ar & atomtypes & xyz & uiso & occupancies;
+            const int n = atomtypes.size();
+            this->reserve(n);
+            for (int i = 0; i < n; ++i)
+            {
+                this->addSite(atomtypes[i],
+                        xyz[3 * i], xyz[3 * i + 1], xyz[3 * i + 2],
+                        uiso[i], occupancies[i]);
+            }
+        }
+
+        BOOST_SERIALIZATION_SPLIT_MEMBER()
+
+};
+
+typedef boost::shared_ptr<XYZStructureAdapter> XYZStructureAdapterPtr;
+
+
+/// Load the first frame of XYZ or extended XYZ file.  Plain XYZ lines
+/// start with element, x, y, z columns and any extra columns are
+/// ignored.  Extended XYZ files define the columns with the Properties
+/// key in the comment line, where the species and pos columns are
+/// required and Uiso and occupancy columns are optional.  Sites without
+/// these columns have zero Uiso and unit occupancy.  The Lattice key is
+/// ignored and the structure is always non-periodic.  Numbers are read
+/// in the classic C locale.  Raise invalid_argument with the line number
+/// for invalid file content.
+XYZStructureAdapterPtr loadXYZ(const std::string& filename);
+
+}   // namespace srrealmodule
+
+#endif  // SRREAL_XYZLOADER_HPP_INCLUDED
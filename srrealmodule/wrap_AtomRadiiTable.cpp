@@ -23,7 +23,10 @@
 #include <diffpy/srreal/ConstantRadiiTable.hpp>
 
 #include "srreal_converters.hpp"
+#include "srreal_instancecache.hpp"
 #include "srreal_pickling.hpp"
+#include "srreal_pqcopy.hpp"
+#include "srreal_symbols.hpp"
 
 namespace srrealmodule {
 namespace nswrap_AtomRadiiTable {
@@ -92,6 +95,16 @@ Return atom radius in Angstroms.\n\
 This method cannot be overloaded in Python.\n\
 ";
 
+const char* doc_AtomRadiiTable_lookupId = "\
+Return empirical radius of an atom type given by its integer ID.\n\
+\n\
+id   -- integer atom type ID from atomTypeId or siteTypeId\n\
+\n\
+Return atom radius in Angstroms.\n\
+This method cannot be overloaded in Python.  The radii are cached in\n\
+an array indexed by the type IDs until any radii table is modified.\n\
+";
+
 const char* doc_AtomRadiiTable__standardLookup = "\
 Standard lookup of empirical atom radius.\n\
 \n\
@@ -182,6 +195,70 @@ DECLARE_PYDICT_METHOD_WRAPPER(getAllCustom, getAllCustom_asdict)
 DECLARE_PYSET_FUNCTION_WRAPPER(AtomRadiiTable::getRegisteredTypes,
         getAtomRadiiTableTypes_asset)
 
+// lookup of the interned atom types.  Several Python objects may wrap
+// the same C++ table, therefore the cached radii are discarded after
+// a change of any radii table.
+
+unsigned long radiitablechanges = 0;
+
+typedef TypeIdCache<double, unsigned long> RadiiIdCache;
+typedef boost::shared_ptr<RadiiIdCache> RadiiIdCachePtr;
+
+double lookupid(object self, int id)
+{
+    RadiiIdCachePtr cache =
+        getinstancecache<RadiiIdCache>(self, "_typeidcache");
+    cache->validate(radiitablechanges);
+    const double* prv = cache->find(id);
+    if (prv)  return *prv;
+    const AtomRadiiTable& obj = extract<const AtomRadiiTable&>(self);
+    return cache->insert(id, obj.lookup(internedSymbol(id)));
+}
+
+// table modifications invalidate the ID lookup caches and give private
+// clones to the calculators that share the table
+
+void radiitablechanged(const AtomRadiiTable& obj)
+{
+    ++radiitablechanges;
+    SharedTableRegistry<AtomRadiiTable>::instance().detach(obj);
+}
+
+
+void setcustom(AtomRadiiTable& obj, const std::string& smbl, double radius)
+{
+    radiitablechanged(obj);
+    obj.setCustom(smbl, radius);
+}
+
+
+void fromstring(AtomRadiiTable& obj, const std::string& s)
+{
+    radiitablechanged(obj);
+    obj.fromString(s);
+}
+
+
+void resetcustom(AtomRadiiTable& obj, const std::string& smbl)
+{
+    radiitablechanged(obj);
+    obj.resetCustom(smbl);
+}
+
+
+void resetall(AtomRadiiTable& obj)
+{
+    radiitablechanged(obj);
+    obj.resetAll();
+}
+
+
+void setdefault(ConstantRadiiTable& obj, double radius)
+{
+    radiitablechanged(obj);
+    obj.setDefault(radius);
+}
+
 // Helper class for overloads of AtomRadiiTable methods from Python
 
 class AtomRadiiTableWrap :
@@ -271,21 +348,19 @@ void wrap_AtomRadiiTable()
         .def("lookup",
                 &AtomRadiiTable::lookup, arg("smbl"),
                 doc_AtomRadiiTable_lookup)
+        .def("lookupId", lookupid, arg("id"),
+                doc_AtomRadiiTable_lookupId)
         .def("_standardLookup",
                 &AtomRadiiTable::standardLookup,
                 arg("smbl"), doc_AtomRadiiTable__standardLookup)
-        .def("setCustom",
-                &AtomRadiiTable::setCustom,
+        .def("setCustom", setcustom,
                 (arg("smbl"), arg("radius")),
                 doc_AtomRadiiTable_setCustom)
-        .def("fromString",
-                &AtomRadiiTable::fromString,
+        .def("fromString", fromstring,
                 doc_AtomRadiiTable_fromString)
-        .def("resetCustom",
-                &AtomRadiiTable::resetCustom, arg("smbl"),
+        .def("resetCustom", resetcustom, arg("smbl"),
                 doc_AtomRadiiTable_resetCustom)
-        .def("resetAll",
-                &AtomRadiiTable::resetAll,
+        .def("resetAll", resetall,
                 doc_AtomRadiiTable_resetAll)
         .def("getAllCustom",
                 getAllCustom_asdict<AtomRadiiTable>,
@@ -298,6 +373,11 @@ void wrap_AtomRadiiTable()
 
     register_ptr_to_python<AtomRadiiTablePtr>();
 
+    // opaque storage for the radii indexed by type IDs
+    class_<RadiiIdCache, RadiiIdCachePtr, noncopyable>("_RadiiIdCache")
+        .def_pickle(EmptyCachePickleSuite<RadiiIdCache>())
+        ;
+
     class_<ConstantRadiiTable, bases<AtomRadiiTable> >(
             "ConstantRadiiTable", doc_ConstantRadiiTable)
         // docstring updates
@@ -309,8 +389,7 @@ void wrap_AtomRadiiTable()
                 &ConstantRadiiTable::standardLookup,
                 arg("smbl"), doc_ConstantRadiiTable__standardLookup)
         // own methods
-        .def("setDefault",
-                &ConstantRadiiTable::setDefault,
+        .def("setDefault", setdefault,
                 arg("radius"),
                 doc_ConstantRadiiTable_setDefault)
         .def("getDefault",
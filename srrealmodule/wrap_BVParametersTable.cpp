@@ -23,7 +23,10 @@
 #include <diffpy/srreal/BVParametersTable.hpp>
 
 #include "srreal_converters.hpp"
+#include "srreal_instancecache.hpp"
 #include "srreal_pickling.hpp"
+#include "srreal_pqcopy.hpp"
+#include "srreal_symbols.hpp"
 
 namespace srrealmodule {
 namespace nswrap_BVParametersTable {
@@ -136,6 +139,19 @@ Return a BVParam object with the looked up data.\n\
 Return BVParametersTable.none() if bond valence data do not exist.\n\
 ";
 
+const char* doc_BVParametersTable_lookupId = "\
+Lookup bond valence parameters by integer IDs of the ion symbols.\n\
+The cation-anion order may be flipped.\n\
+\n\
+id0      -- atom type ID of the first ion with charge, e.g., \"Na+\"\n\
+id1      -- atom type ID of the second ion with charge, e.g., \"O2-\"\n\
+\n\
+Return a BVParam object with the looked up data.\n\
+Return BVParametersTable.none() if bond valence data do not exist.\n\
+The parameters are cached in arrays indexed by the type IDs until\n\
+any BVParametersTable is modified.\n\
+";
+
 const char* doc_BVParametersTable_setCustom1 = "\
 Insert custom bond valence data to the table.\n\
 \n\
@@ -190,9 +206,81 @@ Return a set of BVParam objects.\n\
 
 // wrappers ------------------------------------------------------------------
 
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(setcustom6, setCustom, 6, 7)
 DECLARE_PYSET_METHOD_WRAPPER(getAll, getAll_asset)
 
+// lookup of the interned atom types.  Several Python objects may wrap
+// the same C++ table, therefore the cached parameters are discarded
+// after a change of any BVParametersTable.
+
+unsigned long bvtablechanges = 0;
+
+typedef TypeIdCache<BVParam, int> BVParamIdRow;
+typedef TypeIdCache<BVParamIdRow, unsigned long> BVParamIdCache;
+typedef boost::shared_ptr<BVParamIdCache> BVParamIdCachePtr;
+
+BVParam lookupid(object self, int id0, int id1)
+{
+    BVParamIdCachePtr cache =
+        getinstancecache<BVParamIdCache>(self, "_typeidcache");
+    cache->validate(bvtablechanges);
+    BVParamIdRow* row = cache->find(id0);
+    const BVParam* prv = row ? row->find(id1) : NULL;
+    if (prv)  return *prv;
+    const BVParametersTable& obj = extract<const BVParametersTable&>(self);
+    const BVParam& bp = obj.lookup(internedSymbol(id0), internedSymbol(id1));
+    if (!row)  row = &(cache->insert(id0, BVParamIdRow()));
+    return row->insert(id1, bp);
+}
+
+// table modifications invalidate the ID lookup caches and give private
+// clones to the calculators that share the table
+
+void bvtablechanged(const BVParametersTable& obj)
+{
+    ++bvtablechanges;
+    SharedTableRegistry<BVParametersTable>::instance().detach(obj);
+}
+
+
+void setcustom1(BVParametersTable& obj, const BVParam& bp)
+{
+    bvtablechanged(obj);
+    obj.setCustom(bp);
+}
+
+
+void setcustom6(BVParametersTable& obj,
+        const std::string& atom0, int valence0,
+        const std::string& atom1, int valence1,
+        double Ro, double B, std::string ref_id)
+{
+    bvtablechanged(obj);
+    obj.setCustom(atom0, valence0, atom1, valence1, Ro, B, ref_id);
+}
+
+
+void resetcustom1(BVParametersTable& obj, const BVParam& bp)
+{
+    bvtablechanged(obj);
+    obj.resetCustom(bp);
+}
+
+
+void resetcustom4(BVParametersTable& obj,
+        const std::string& atom0, int valence0,
+        const std::string& atom1, int valence1)
+{
+    bvtablechanged(obj);
+    obj.resetCustom(atom0, valence0, atom1, valence1);
+}
+
+
+void resetall(BVParametersTable& obj)
+{
+    bvtablechanged(obj);
+    obj.resetAll();
+}
+
 object repr_BVParam(const BVParam& bp)
 {
     object rv = ("BVParam(%r, %i, %r, %i, Ro=%s, B=%s, ref_id=%r)" %
@@ -255,10 +343,6 @@ void wrap_BVParametersTable()
             const string&, const string&) const;
     typedef const BVParam&(BVParametersTable::*bptb_bvparam_4)(
             const string&, int, const string&, int) const;
-    typedef void(BVParametersTable::*bptb_void_1)(
-            const BVParam&);
-    typedef void(BVParametersTable::*bptb_void_4)(
-            const string&, int, const string&, int);
 
     class_<BVParametersTable>("BVParametersTable", doc_BVParametersTable)
         .def("none", singleton_none, doc_BVParametersTable_none)
@@ -274,19 +358,21 @@ void wrap_BVParametersTable()
                 (arg("atom0"), arg("valence0"), arg("atom1"), arg("valence1")),
                 doc_BVParametersTable_lookup4,
                 return_value_policy<copy_const_reference>())
-        .def("setCustom", bptb_void_1(&BVParametersTable::setCustom),
+        .def("lookupId", lookupid,
+                (arg("id0"), arg("id1")),
+                doc_BVParametersTable_lookupId)
+        .def("setCustom", setcustom1,
                 arg("bvparm"), doc_BVParametersTable_setCustom1)
-        .def("setCustom", (void(BVParametersTable::*)(const string&, int,
-                    const string&, int, double, double, string)) NULL,
-                setcustom6((arg("atom0"), arg("valence0"), arg("atom1"), arg("valence1"),
-                     arg("Ro"), arg("B"), arg("ref_id")=""),
-                    doc_BVParametersTable_setCustom6))
-        .def("resetCustom", bptb_void_1(&BVParametersTable::resetCustom),
+        .def("setCustom", setcustom6,
+                (arg("atom0"), arg("valence0"), arg("atom1"), arg("valence1"),
+                 arg("Ro"), arg("B"), arg("ref_id")=""),
+                doc_BVParametersTable_setCustom6)
+        .def("resetCustom", resetcustom1,
                 doc_BVParametersTable_resetCustom1)
-        .def("resetCustom", bptb_void_4(&BVParametersTable::resetCustom),
+        .def("resetCustom", resetcustom4,
                 (arg("atom0"), arg("valence0"), arg("atom1"), arg("valence1")),
                 doc_BVParametersTable_resetCustom4)
-        .def("resetAll", &BVParametersTable::resetAll,
+        .def("resetAll", resetall,
                 doc_BVParametersTable_resetAll)
         .def("getAll", getAll_asset<BVParametersTable>,
                 doc_BVParametersTable_getAll)
@@ -294,6 +380,12 @@ void wrap_BVParametersTable()
         ;
 
     register_ptr_to_python<BVParametersTablePtr>();
+
+    // opaque storage for the parameters indexed by type IDs
+    class_<BVParamIdCache, BVParamIdCachePtr, boost::noncopyable>(
+            "_BVParamIdCache")
+        .def_pickle(EmptyCachePickleSuite<BVParamIdCache>())
+        ;
 }
 
 }   // namespace srrealmodule
@@ -22,6 +22,7 @@
 
 #include "srreal_converters.hpp"
 #include "srreal_pickling.hpp"
+#include "srreal_pqcopy.hpp"
 
 namespace srrealmodule {
 namespace nswrap_BVSCalculator {
@@ -67,16 +68,50 @@ BVParametersTable object used for bond valence parameters lookup.\n\
 DECLARE_PYARRAY_METHOD_WRAPPER(valences, valences_asarray)
 DECLARE_PYARRAY_METHOD_WRAPPER(bvdiff, bvdiff_asarray)
 
-BVParametersTablePtr getbvparamtable(BVSCalculator& obj)
+// access functions for sharing the table with copied calculators
+
+BVParametersTablePtr getownerbvparamtable(object owner)
 {
+    BVSCalculator& obj = extract<BVSCalculator&>(owner);
     return obj.getBVParamTable();
 }
 
+
+void setownerbvparamtable(object owner, BVParametersTablePtr bptb)
+{
+    BVSCalculator& obj = extract<BVSCalculator&>(owner);
+    obj.setBVParamTable(bptb);
+}
+
+
+BVParametersTablePtr clonebvparamtable(const BVParametersTable& bptb)
+{
+    return BVParametersTablePtr(new BVParametersTable(bptb));
+}
+
+
+const SharedTableRegistry<BVParametersTable>::OwnerAccess bvtableaccess =
+    {getownerbvparamtable, setownerbvparamtable, clonebvparamtable};
+
+
+BVParametersTablePtr getbvparamtable(object owner)
+{
+    return getsharedtable<BVParametersTable>(owner, bvtableaccess);
+}
+
 void setbvparamtable(BVSCalculator& obj, BVParametersTablePtr bptb)
 {
     obj.setBVParamTable(bptb);
 }
 
+// support for the native copy method
+
+void clonebvscalculator(object src, object pqobj)
+{
+    SharedTableRegistry<BVParametersTable>::instance().share(
+            src, pqobj, bvtableaccess);
+}
+
 }   // namespace nswrap_BVSCalculator
 
 // Wrapper definition --------------------------------------------------------
@@ -99,6 +134,8 @@ void wrap_BVSCalculator()
                 doc_BVSCalculator_bvrmsdiff)
         .add_property("bvparamtable", getbvparamtable, setbvparamtable,
                 doc_BVSCalculator_bvparamtable)
+        .def("copy", pqclone<BVSCalculator, clonebvscalculator>,
+                doc_PairQuantity_nativecopy)
         .def_pickle(SerializationPickleSuite<BVSCalculator>())
         ;
 
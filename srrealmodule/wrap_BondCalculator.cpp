@@ -23,6 +23,7 @@
 
 #include "srreal_converters.hpp"
 #include "srreal_pickling.hpp"
+#include "srreal_pqcopy.hpp"
 
 namespace srrealmodule {
 namespace nswrap_BondCalculator {
@@ -131,6 +132,8 @@ void wrap_BondCalculator()
                 doc_BondCalculator_filterCone)
         .def("filterOff", &BondCalculator::filterOff,
                 doc_BondCalculator_filterOff)
+        .def("copy", pqclone<BondCalculator, pqnoclonecomponents>,
+                doc_PairQuantity_nativecopy)
         .def_pickle(SerializationPickleSuite<BondCalculator>())
         ;
 
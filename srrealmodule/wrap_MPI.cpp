@@ -0,0 +1,271 @@
+/*****************************************************************************
+*
+* diffpy.srreal     by DANSE Diffraction group
+*                   Simon J. L. Billinge
+*                   (c) 2013 Trustees of the Columbia University
+*                   in the City of New York.  All rights reserved.
+*
+* File coded by:    Pavol Juhas
+*
+* See AUTHORS.txt for a list of people who contributed.
+* See LICENSE.txt for license information.
+*
+******************************************************************************
+*
+* Bindings to the MPI collective operations used by the mpiparallel module
+* for evaluating a PairQuantity over all ranks of MPI_COMM_WORLD.
+* The MPI code is compiled only when SRREAL_MPI is defined, otherwise
+* the functions raise RuntimeError.
+*
+*****************************************************************************/
+
+#include <boost/python.hpp>
+#include <climits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef SRREAL_MPI
+#include <mpi.h>
+#endif
+
+#include <diffpy/srreal/PairQuantity.hpp>
+
+#include "srreal_pqaccess.hpp"
+
+namespace srrealmodule {
+namespace nswrap_MPI {
+
+using namespace boost::python;
+using diffpy::srreal::PairQuantity;
+using diffpy::srreal::QuantityType;
+
+// docstrings ----------------------------------------------------------------
+
+const char* doc__mpiAvailable = "\
+Return True if srreal_ext was built with MPI support.\n\
+";
+
+const char* doc__mpiRankSize = "\
+Return a tuple of (rank, size) for MPI_COMM_WORLD.\n\
+Initialize MPI if necessary.  MPI is then finalized at exit.\n\
+Raise RuntimeError if srreal_ext was built without MPI.\n\
+";
+
+const char* doc__mpiBroadcast = "\
+Broadcast data string from the root rank to all ranks.\n\
+This is a collective call that must be executed on every rank.\n\
+\n\
+data     -- string to be sent from the root rank.  Ignored elsewhere.\n\
+root     -- rank of the sending process.\n\
+\n\
+Return the data string from the root rank.\n\
+";
+
+const char* doc__mpiAllreduceValue = "\
+Sum the internal values of a PairQuantity over all ranks in place.\n\
+This is a collective call that must be executed on every rank after\n\
+a partial evaluation configured by _setupParallelRun(rank, size).\n\
+The values must have the same length on all ranks and their sum must\n\
+be the total value, as for PDFCalculator and DebyePDFCalculator.\n\
+\n\
+pq       -- PairQuantity object with additive internal values.\n\
+finish   -- flag for calling the finishValue method after the sum.\n\
+\n\
+No return value.\n\
+";
+
+const char* doc__mpiReduceData = "\
+Sum the partial results of a PairQuantity from all ranks at the root.\n\
+This is a collective call that must be executed on every rank after\n\
+a partial evaluation configured by _setupParallelRun(rank, size).\n\
+It is used for calculators whose values are not a plain sum.\n\
+The _getParallelData strings are combined along a binomial tree,\n\
+where every rank receives from at most log2(size) ranks and sends its\n\
+_reduceParallelData sum once towards the root.\n\
+\n\
+pq       -- PairQuantity object with partial results of this rank.\n\
+            Its internal values are changed on the inner tree nodes.\n\
+root     -- rank that receives the total sum.\n\
+\n\
+Return raw results string at the root rank to be merged with\n\
+_mergeParallelData for ncpu=1.  Return empty string on other ranks.\n\
+";
+
+// wrappers ------------------------------------------------------------------
+
+#ifdef SRREAL_MPI
+
+void finalizempi()
+{
+    int finalized = 0;
+    MPI_Finalized(&finalized);
+    if (!finalized)  MPI_Finalize();
+}
+
+
+void initializempi()
+{
+    int initialized = 0;
+    MPI_Initialized(&initialized);
+    if (initialized)  return;
+    int provided;
+    MPI_Init_thread(NULL, NULL, MPI_THREAD_FUNNELED, &provided);
+    Py_AtExit(finalizempi);
+}
+
+
+int messagesize(size_t sz)
+{
+    if (sz > size_t(INT_MAX))
+    {
+        const char* emsg = "Data too large for a single MPI message.";
+        throw std::invalid_argument(emsg);
+    }
+    return int(sz);
+}
+
+#else
+
+void initializempi()
+{
+    const char* emsg = "srreal_ext was built without MPI support.";
+    throw std::runtime_error(emsg);
+}
+
+#endif  // SRREAL_MPI
+
+
+bool mpi_available()
+{
+#ifdef SRREAL_MPI
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+tuple mpi_rank_size()
+{
+    initializempi();
+    int rank = 0;
+    int size = 1;
+#ifdef SRREAL_MPI
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+#endif
+    return make_tuple(rank, size);
+}
+
+
+std::string mpi_broadcast(const std::string& data, int root)
+{
+    initializempi();
+    std::string rv = data;
+#ifdef SRREAL_MPI
+    int sz = messagesize(data.size());
+    MPI_Bcast(&sz, 1, MPI_INT, root, MPI_COMM_WORLD);
+    rv.resize(sz);
+    if (sz)  MPI_Bcast(&(rv[0]), sz, MPI_CHAR, root, MPI_COMM_WORLD);
+#endif
+    return rv;
+}
+
+
+std::string mpi_reduce_data(object pq, int root)
+{
+    initializempi();
+    std::string rv = extract<std::string>(pq.attr("_getParallelData")());
+#ifdef SRREAL_MPI
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    if (root < 0 || root >= size)
+    {
+        const char* emsg = "Invalid MPI root rank.";
+        throw std::invalid_argument(emsg);
+    }
+    // rank relative to the root which is the tree top
+    const int rrank = (rank - root + size) % size;
+    const int tag = 0;
+    std::vector<char> buffer;
+    for (int mask = 1; mask < size; mask <<= 1)
+    {
+        if (rrank & mask)
+        {
+            int dest = (rrank - mask + root) % size;
+            MPI_Send(const_cast<char*>(rv.data()), messagesize(rv.size()),
+                    MPI_CHAR, dest, tag, MPI_COMM_WORLD);
+            rv.clear();
+            break;
+        }
+        if (rrank + mask >= size)  continue;
+        int src = (rrank + mask + root) % size;
+        MPI_Status status;
+        MPI_Probe(src, tag, MPI_COMM_WORLD, &status);
+        int sz;
+        MPI_Get_count(&status, MPI_CHAR, &sz);
+        buffer.resize(sz + 1);
+        MPI_Recv(&(buffer[0]), sz, MPI_CHAR, src, tag,
+                MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        // source ranks follow this one so the sum keeps the rank order
+        list pdatalist;
+        pdatalist.append(rv);
+        pdatalist.append(std::string(&(buffer[0]), &(buffer[0]) + sz));
+        rv = extract<std::string>(pq.attr("_reduceParallelData")(pdatalist));
+    }
+#endif
+    return rv;
+}
+
+
+void mpi_allreduce_value(PairQuantity& pq, bool finish)
+{
+    initializempi();
+#ifdef SRREAL_MPI
+    QuantityType& value = PairQuantityAccess::valueOf(pq);
+    int n = messagesize(value.size());
+    int nmin = n;
+    MPI_Allreduce(&n, &nmin, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    int nmax = n;
+    MPI_Allreduce(&n, &nmax, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+    if (nmin != nmax)
+    {
+        const char* emsg = "Values have different lengths on MPI ranks.";
+        throw std::invalid_argument(emsg);
+    }
+    if (n)
+    {
+        MPI_Allreduce(MPI_IN_PLACE, &(value[0]), n, MPI_DOUBLE,
+                MPI_SUM, MPI_COMM_WORLD);
+    }
+#endif
+    if (finish)  PairQuantityAccess::finishValueOf(pq);
+}
+
+}   // namespace nswrap_MPI
+
+// Wrapper definition --------------------------------------------------------
+
+void wrap_MPI()
+{
+    using namespace nswrap_MPI;
+    namespace bp = boost::python;
+
+    def("_mpiAvailable", mpi_available, doc__mpiAvailable);
+    def("_mpiRankSize", mpi_rank_size, doc__mpiRankSize);
+    def("_mpiBroadcast", mpi_broadcast,
+            (bp::arg("data"), bp::arg("root")=0),
+            doc__mpiBroadcast);
+    def("_mpiAllreduceValue", mpi_allreduce_value,
+            (bp::arg("pq"), bp::arg("finish")=true),
+            doc__mpiAllreduceValue);
+    def("_mpiReduceData", mpi_reduce_data,
+            (bp::arg("pq"), bp::arg("root")=0),
+            doc__mpiReduceData);
+}
+
+}   // namespace srrealmodule
+
+// End of file
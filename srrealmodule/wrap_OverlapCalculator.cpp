@@ -22,6 +22,7 @@
 
 #include "srreal_converters.hpp"
 #include "srreal_pickling.hpp"
+#include "srreal_pqcopy.hpp"
 
 namespace srrealmodule {
 namespace nswrap_OverlapCalculator {
@@ -148,13 +149,55 @@ DECLARE_PYARRAY_METHOD_WRAPPER(coordinations, coordinations_asarray)
 DECLARE_PYDICT_METHOD_WRAPPER1(coordinationByTypes, coordinationByTypes_asdict)
 DECLARE_PYLISTSET_METHOD_WRAPPER(neighborhoods, neighborhoods_aslistset)
 
-AtomRadiiTablePtr getatomradiitable(OverlapCalculator& obj)
+// access functions for sharing the table with copied calculators
+
+AtomRadiiTablePtr getownerradiitable(object owner)
 {
+    OverlapCalculator& obj = extract<OverlapCalculator&>(owner);
     return obj.getAtomRadiiTable();
 }
 
+
+void setownerradiitable(object owner, AtomRadiiTablePtr tb)
+{
+    OverlapCalculator& obj = extract<OverlapCalculator&>(owner);
+    obj.setAtomRadiiTable(tb);
+}
+
+
+AtomRadiiTablePtr cloneradiitable(const AtomRadiiTable& tb)
+{
+    return tb.clone();
+}
+
+
+const SharedTableRegistry<AtomRadiiTable>::OwnerAccess radiitableaccess =
+    {getownerradiitable, setownerradiitable, cloneradiitable};
+
+
+AtomRadiiTablePtr getatomradiitable(object owner)
+{
+    return getsharedtable<AtomRadiiTable>(owner, radiitableaccess);
+}
+
 DECLARE_BYTYPE_SETTER_WRAPPER(setAtomRadiiTable, setatomradiitable)
 
+// support for the native copy method
+
+void cloneoverlapcalculator(object src, object pqobj)
+{
+    OverlapCalculator& obj = extract<OverlapCalculator&>(pqobj);
+    AtomRadiiTablePtr artb = obj.getAtomRadiiTable();
+    // Python-derived tables can change without the wrapped mutators
+    if (ispythonderived(artb.get()))
+    {
+        obj.setAtomRadiiTable(artb->clone());
+        return;
+    }
+    SharedTableRegistry<AtomRadiiTable>::instance().share(
+            src, pqobj, radiitableaccess);
+}
+
 
 double flip_diff_total(const OverlapCalculator& obj, object i, object j)
 {
@@ -278,6 +321,8 @@ void wrap_OverlapCalculator()
                 getatomradiitable,
                 setatomradiitable<OverlapCalculator,AtomRadiiTable>,
                 doc_OverlapCalculator_atomradiitable)
+        .def("copy", pqclone<OverlapCalculator, cloneoverlapcalculator>,
+                doc_PairQuantity_nativecopy)
         .def_pickle(OverlapCalculatorPickleSuite())
         ;
 
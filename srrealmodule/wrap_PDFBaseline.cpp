@@ -155,14 +155,14 @@ class PDFBaselineWrap :
 
 std::string baseline_tostring(PDFBaselinePtr obj)
 {
-    return diffpy::serialization_tostring(obj);
+    return pickle_tostring(obj);
 }
 
 
 PDFBaselinePtr baseline_fromstring(std::string content)
 {
     PDFBaselinePtr rv;
-    diffpy::serialization_fromstring(rv, content);
+    pickle_fromstring(rv, content);
     return rv;
 }
 
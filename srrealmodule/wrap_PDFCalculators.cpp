@@ -18,13 +18,35 @@
 
 #include <boost/python.hpp>
 #include <boost/python/stl_iterator.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/serialization/vector.hpp>
+#include <algorithm>
+#include <functional>
+#include <sstream>
+#include <cassert>
+#include <cmath>
+#include <set>
+#include <stdexcept>
+#include <vector>
 
 #include <diffpy/srreal/DebyePDFCalculator.hpp>
 #include <diffpy/srreal/PDFCalculator.hpp>
 #include <diffpy/srreal/PythonStructureAdapter.hpp>
 
 #include "srreal_converters.hpp"
+#include "srreal_instancecache.hpp"
 #include "srreal_pickling.hpp"
+#include "srreal_pqaccess.hpp"
+#include "srreal_pqcopy.hpp"
+#include "srreal_debyehistogram.hpp"
+#include "srreal_sinetransform.hpp"
+#include "srreal_sflookup.hpp"
+#include "srreal_sitetypes.hpp"
+// numpy/arrayobject.h needs to be included after srreal_converters.hpp,
+// which defines PY_ARRAY_UNIQUE_SYMBOL.  NO_IMPORT_ARRAY indicates
+// import_array will be called in the extension module initializer.
+#define NO_IMPORT_ARRAY
+#include <numpy/arrayobject.h>
 
 namespace srrealmodule {
 namespace nswrap_PDFCalculators {
@@ -56,6 +78,85 @@ An array of Q-values in 1/A.  This is a uniformly spaced array of qstep\n\
 values that start at 0/A and are smaller than qmax.\n\
 ";
 
+const char* doc_PDFCommon_value = "\
+Internal vector of total contributions as numpy array, read-only.\n\
+The array has float32 type in the singleprecision mode.\n\
+";
+
+const char* doc_PDFCommon_eval = "\
+Calculate quantity for the specified structure.\n\
+\n\
+stru -- object that can be converted to StructureAdapter,\n\
+        e.g., example diffpy Structure or pyobjcryst Crystal.\n\
+        Use the last structure when None.\n\
+\n\
+Return a copy of the internal total contributions.  The array has\n\
+float32 type in the singleprecision mode.\n\
+";
+
+const char* doc_PDFCommon__getParallelData = "\
+Return raw results string from a parallel job.\n\
+\n\
+In the singleprecision mode the string contains the partial values\n\
+rounded to float32, which halves the transferred data.\n\
+The string is processed by the _mergeParallelData method.\n\
+";
+
+const char* doc_PDFCommon__mergeParallelData = "\
+Add raw results string from a parallel job to this instance.\n\
+\n\
+pdata    -- raw data string from the parallel _getParallelData function.\n\
+            This can be in any of the double or single precision formats.\n\
+ncpu     -- number of parallel jobs.  The finishValue method is called after\n\
+            merging ncpu parallel values.\n\
+\n\
+The partial values are always added in double precision.\n\
+No return value.\n\
+";
+
+const char* doc_PDFCommon__reduceParallelData = "\
+Combine raw results strings from several parallel jobs into one.\n\
+\n\
+pdatalist -- sequence of raw data strings from _getParallelData\n\
+            of the parallel jobs in any of the precision formats.\n\
+\n\
+Return raw results string of the summed partial values in the\n\
+precision of this instance.  The result should be merged with\n\
+_mergeParallelData for ncpu=1.  This changes the internal values.\n\
+";
+
+const char* doc_PDFCommon__getParallelValue = "\
+Return the partial value array from a parallel job.\n\
+\n\
+This is a faster alternative to _getParallelData that avoids the\n\
+serialization of the array.  The result is a numpy array, which can\n\
+be pickled as raw data or transferred as an out-of-band buffer.\n\
+It has float32 type in the singleprecision mode.\n\
+";
+
+const char* doc_PDFCommon__mergeParallelValue = "\
+Add partial value array from a parallel job to this instance.\n\
+\n\
+pvalue   -- array from the _getParallelValue method of a parallel job\n\
+            or any 1D object with a float64 or float32 buffer.\n\
+finish   -- flag for calling finishValue after the merge.  This must be\n\
+            set for the last merged partial value.\n\
+\n\
+No return value.  The partial values must be merged after the\n\
+resetValue call, for example from setStructure.\n\
+Raise ValueError if pvalue has a different size than this value.\n\
+";
+
+const char* doc_PDFCommon__reduceParallelValue = "\
+Sum partial value arrays from parallel jobs in double precision.\n\
+\n\
+pvaluelist -- sequence of arrays from _getParallelValue or from\n\
+            earlier _reduceParallelValue calls.\n\
+\n\
+Return float64 numpy array to be merged with _mergeParallelValue.\n\
+Raise ValueError if the arrays have different sizes.\n\
+";
+
 const char* doc_PDFCommon_envelopes = "\
 A tuple of PDFEnvelope instances used for calculating scaling envelope.\n\
 This property can be assigned an iterable of PDFEnvelope objects.\n\
@@ -104,6 +205,51 @@ const char* doc_PDFCommon_clearEnvelopes = "\
 Remove all PDFEnvelope scaling functions from the calculator.\n\
 ";
 
+const char* doc_PDFCommon_evalPartials = "\
+Calculate partial PDFs for all pairs of atom types in a single pass.\n\
+\n\
+stru -- structure object that can be converted to StructureAdapter.\n\
+        Use the last structure when None.\n\
+\n\
+Return a tuple of (types, weights, partials).  types is a sorted tuple\n\
+of atom type symbols, weights is an (N, N) array of the normalized\n\
+products c_i c_j f_i f_j / (sum c f)**2 of site counts and scattering\n\
+factors at Q=0 and partials is an (N, N, len(rgrid)) array of the\n\
+normalized partial PDFs.  The total PDF equals the weighted sum\n\
+numpy.tensordot(weights, partials) and it also becomes the new value\n\
+of this calculator.  Pairs excluded by the pair mask are not included.\n\
+";
+
+const char* doc_PDFCommon_evalTables = "\
+Calculate PDFs for several scattering factor tables in a single pass.\n\
+The pair distances and peak widths are evaluated once and only\n\
+the weights of atom-type pairs are specific to each table.\n\
+\n\
+tables   -- sequence of ScatteringFactorTable objects or their string\n\
+            types, for example ('xray', 'neutron').\n\
+stru     -- structure object that can be converted to StructureAdapter.\n\
+            Use the last structure when None.\n\
+\n\
+Return an (len(tables), len(rgrid)) array of the PDFs.\n\
+The calculator keeps its own scatteringfactortable and the value\n\
+evaluated with that table.  Pairs excluded by the pair mask are not\n\
+included.\n\
+";
+
+const char* doc_PDFCommon__sweepPairs = "\
+Evaluate several copies of this calculator in a single pair sweep.\n\
+Every pair of the current structure is generated once and added to\n\
+all copies whose bond range contains the pair distance.\n\
+\n\
+calcs    -- sequence of calculators of the same type with the same\n\
+            structure and pair mask as this calculator, for example\n\
+            from the copy method.\n\
+\n\
+No return value.  The calcs get finished values for their own\n\
+attributes, the value of this calculator is not changed.\n\
+Raise ValueError if any calculator has a different number of sites.\n\
+";
+
 const char* doc_DebyePDFCalculator = "\
 Calculate PDF using the Debye scattering equation.\n\
 ";
@@ -120,10 +266,75 @@ Return True if qstep is set to an optimum, rmax-dependent value.\n\
 Return False if qstep was overridden by the user.\n\
 ";
 
+const char* doc_DebyePDFCalculator_evalHistogram = "\
+Calculate PDF from a histogram of pair distances.  This is an approximate\n\
+and much faster alternative to eval for large structures.  Pairs are\n\
+binned by atom types, by the Gaussian variance s2 of the peak width\n\
+model in steps of msdstep and by distance in steps of binwidth.  The\n\
+Debye sum is then evaluated once per histogram cell at the mean distance\n\
+and variance of its pairs.\n\
+\n\
+stru     -- structure object that can be converted to StructureAdapter.\n\
+            Use the last structure when None.\n\
+binwidth -- width of the distance bins in Angstroms.\n\
+msdstep  -- width of the msd classes in A**2.\n\
+\n\
+The relative error of every pair term in F(Q) is bounded by\n\
+(qmax * binwidth)**2 / 8 + (qmax**2 * msdstep)**2 / 32,\n\
+which is about 1e-4 for the default values and qmax=25.\n\
+\n\
+The sine terms are evaluated with the histogramkernel method.  Only this\n\
+histogram path has the SIMD and multithreaded kernels, the exact eval\n\
+method uses the scalar pair summation of libdiffpy.\n\
+\n\
+The histogram sums exclude scattering factors and are cached for the\n\
+same structure, peak width model, histogram settings and Q-grid.\n\
+A subsequent call after a change of the scatteringfactortable or its\n\
+custom values only recombines the cached sums with the new form factors.\n\
+\n\
+Return a copy of the internal total contributions, same as eval.\n\
+Raise ValueError for non-positive binwidth or msdstep.\n\
+";
+
 const char* doc_PDFCalculator = "\
 Calculate PDF using the real-space summation of PeakProfile functions.\n\
 ";
 
+const char* doc_PDFCalculator_evalDerivatives = "\
+Calculate PDF derivatives with respect to atom positions and displacement\n\
+parameters in the same pass as the PDF value.  Requires the 'gaussian'\n\
+peakprofile and one of the 'constant', 'debye-waller' or 'jeong' peak\n\
+width models.\n\
+\n\
+stru -- structure object that can be converted to StructureAdapter.\n\
+        Use the last structure when None.\n\
+\n\
+Return a tuple of (dGdxyz, dGdUij).  dGdxyz is an (nsites, 3, len(rgrid))\n\
+array of derivatives with respect to Cartesian coordinates, dGdUij is an\n\
+(nsites, 6, len(rgrid)) array of derivatives with respect to Cartesian\n\
+U11, U22, U33, U12, U13, U23 of each site.  For isotropic sites the\n\
+derivative over Uiso is the sum of the U11, U22 and U33 terms.  The PDF\n\
+becomes the new value of this calculator.  The derivatives are exact for\n\
+structures that are not expanded by symmetry operations, such as the\n\
+diffpy.Structure objects with explicit atoms in the unit cell.\n\
+Raise ValueError for unsupported peak profile or peak width model.\n\
+";
+
+const char* doc_PDFCalculator_evalQmaxes = "\
+Calculate PDFs for several qmax values in a single pass.\n\
+The peak sums are evaluated once over the widest extended r-range\n\
+and only the qmax-dependent termination is applied for every qmax.\n\
+The peak sums are evaluated separately for every qmax when the\n\
+peak profile itself depends on qmax.\n\
+\n\
+qmaxes   -- sequence of qmax values in 1/A, zero for no termination.\n\
+stru     -- structure object that can be converted to StructureAdapter.\n\
+            Use the last structure when None.\n\
+\n\
+Return an (len(qmaxes), len(rgrid)) array of the PDFs.\n\
+The calculator keeps its own qmax and the value for that qmax.\n\
+";
+
 const char* doc_PDFCalculator_peakprofile = "\
 Instance of PeakProfile that calculates the real-space profile for\n\
 a single atom-pair contribution.  This can be assigned either a\n\
@@ -140,12 +351,16 @@ Use PDFBaseline.getRegisteredTypes() for the set of allowed values.\n\
 
 const char* doc_fftftog = "\
 Perform sine-fast Fourier transform from F(Q) to G(r).\n\
-The length of the output array is padded to the next power of 2.\n\
+The length of the output array is padded to the next power of 2\n\
+unless specified by npad.\n\
 \n\
 f        -- array of the F values on a regular Q-space grid.\n\
 qstep    -- spacing in the Q-space grid, this is used for proper\n\
             scaling of the output array.\n\
 qmin     -- optional starting point of the Q-space grid.\n\
+npad     -- optional exact length of the output array, at least\n\
+            qmin / qstep + len(f).  Any length is O(npad log npad),\n\
+            powers of 2 are fastest.  Use the next power of 2 when 0.\n\
 \n\
 Return a tuple of (g, rstep).  These can be used with the complementary\n\
 fftgtof function to recover the original signal f.\n\
@@ -153,12 +368,16 @@ fftgtof function to recover the original signal f.\n\
 
 const char* doc_fftgtof = "\
 Perform sine-fast Fourier transform from G(r) to F(Q).\n\
-The length of the output array is padded to the next power of 2.\n\
+The length of the output array is padded to the next power of 2\n\
+unless specified by npad.\n\
 \n\
 g        -- array of the G values on a regular r-space grid.\n\
 rstep    -- spacing in the r-space grid, this is used for proper\n\
             scaling of the output array.\n\
 rmin     -- optional starting point of the r-space grid.\n\
+npad     -- optional exact length of the output array, at least\n\
+            rmin / rstep + len(g).  Any length is O(npad log npad),\n\
+            powers of 2 are fastest.  Use the next power of 2 when 0.\n\
 \n\
 Return a tuple of (f, qstep).  These can be used with the complementary\n\
 fftftog function to recover the original signal g.\n\
@@ -264,6 +483,1175 @@ PDFEnvelopePtr getoneenvelope(T& obj, const std::string& tp)
 }
 
 
+// result arrays in the precision of the singleprecision setting
+
+bool issingleprecision(object self)
+{
+    bool rv = extract<bool>(self.attr("singleprecision"));
+    return rv;
+}
+
+
+#define DECLARE_PRECISION_ARRAY_WRAPPER(method, wrapper) \
+    template <class T> \
+    object wrapper(object self) \
+    { \
+        const T& obj = extract<const T&>(self); \
+        object rv = convertToNumPyArray(obj.method(), \
+                issingleprecision(self)); \
+        return rv; \
+    } \
+
+DECLARE_PRECISION_ARRAY_WRAPPER(value, getvaluearray)
+DECLARE_PRECISION_ARRAY_WRAPPER(getPDF, getpdfarray)
+DECLARE_PRECISION_ARRAY_WRAPPER(getRDF, getrdfarray)
+DECLARE_PRECISION_ARRAY_WRAPPER(getF, getfarray)
+
+#undef DECLARE_PRECISION_ARRAY_WRAPPER
+
+
+template <class T>
+object evalarray(object self, object stru)
+{
+    T& obj = extract<T&>(self);
+    QuantityType value = (Py_None == stru.ptr()) ?
+        obj.eval() : obj.eval(stru);
+    object rv = convertToNumPyArray(value, issingleprecision(self));
+    return rv;
+}
+
+// parallel data in the single precision mode.  The string starts with
+// a marker that cannot begin a serialized archive and is followed by
+// the raw float32 values.
+
+const std::string PARALLELDATAFLOAT32 = "srreal-float32\n";
+
+
+template <class T>
+std::string getparalleldata(object self)
+{
+    const T& obj = extract<const T&>(self);
+    if (!issingleprecision(self))  return obj.getParallelData();
+    const QuantityType& value = obj.value();
+    std::vector<float> fvalue(value.begin(), value.end());
+    std::string rv = PARALLELDATAFLOAT32;
+    const char* pf = reinterpret_cast<const char*>(
+            fvalue.empty() ? 0 : &(fvalue[0]));
+    rv.append(pf, pf + fvalue.size() * sizeof(float));
+    return rv;
+}
+
+
+// convert parallel data in any precision to the serialized value array
+
+std::string doubleparalleldata(const std::string& pdata)
+{
+    const size_t nhead = PARALLELDATAFLOAT32.size();
+    if (0 != pdata.compare(0, nhead, PARALLELDATAFLOAT32))  return pdata;
+    if (0 != (pdata.size() - nhead) % sizeof(float))
+    {
+        const char* emsg = "Invalid size of the float32 parallel data.";
+        throw std::invalid_argument(emsg);
+    }
+    const int n = (pdata.size() - nhead) / sizeof(float);
+    std::vector<float> fvalue(n);
+    if (n)  pdata.copy(reinterpret_cast<char*>(&(fvalue[0])),
+            n * sizeof(float), nhead);
+    QuantityType pvalue(fvalue.begin(), fvalue.end());
+    return diffpy::serialization_tostring(pvalue);
+}
+
+
+template <class T>
+void mergeparalleldata(T& obj, const std::string& pdata, int ncpu)
+{
+    obj.mergeParallelData(doubleparalleldata(pdata), ncpu);
+}
+
+
+template <class T>
+std::string reduceparalleldata(object self, object pdatalist)
+{
+    T& obj = extract<T&>(self);
+    stl_input_iterator<std::string> first(pdatalist), last;
+    PairQuantityAccess::resetValueOf(obj);
+    for (; first != last; ++first)
+    {
+        PairQuantityAccess::executeParallelMergeOf(obj,
+                doubleparalleldata(*first));
+    }
+    return getparalleldata<T>(self);
+}
+
+// parallel partial values as raw arrays
+
+template <class T>
+object getparallelvalue(object self)
+{
+    const T& obj = extract<const T&>(self);
+    object rv = convertToNumPyArray(obj.value(), issingleprecision(self));
+    return rv;
+}
+
+
+// add float64 or float32 array pvalue to value in double precision.
+// Empty value is resized to the size of pvalue.
+
+void addparallelvalue(QuantityType& value, object pvalue, bool resize)
+{
+    PyObject* pobj = pvalue.ptr();
+    const bool isfloat32 = PyArray_Check(pobj) &&
+        (NPY_FLOAT == PyArray_TYPE(pobj));
+    const int typenum = isfloat32 ? NPY_FLOAT : NPY_DOUBLE;
+    PyObject* pa = PyArray_ContiguousFromAny(pobj, typenum, 1, 1);
+    if (!pa)  throw_error_already_set();
+    object pao((handle<>(pa)));
+    const size_t n = PyArray_DIM(pa, 0);
+    if (resize)  value.assign(n, 0.0);
+    if (n != value.size())
+    {
+        const char* emsg = "Merged data array must have the same size.";
+        throw std::invalid_argument(emsg);
+    }
+    if (isfloat32)
+    {
+        const float* pf = static_cast<const float*>(PyArray_DATA(pa));
+        std::transform(value.begin(), value.end(), pf,
+                value.begin(), std::plus<double>());
+    }
+    else
+    {
+        const double* pd = static_cast<const double*>(PyArray_DATA(pa));
+        std::transform(value.begin(), value.end(), pd,
+                value.begin(), std::plus<double>());
+    }
+}
+
+
+template <class T>
+void mergeparallelvalue(T& obj, object pvalue, bool finish)
+{
+    QuantityType& value = PairQuantityAccess::valueOf(obj);
+    addparallelvalue(value, pvalue, false);
+    if (finish)  PairQuantityAccess::finishValueOf(obj);
+}
+
+
+object reduceparallelvalue(object pvaluelist)
+{
+    QuantityType value;
+    stl_input_iterator<object> pv(pvaluelist), pvend;
+    for (bool first = true; pv != pvend; ++pv, first = false)
+    {
+        addparallelvalue(value, *pv, first);
+    }
+    return convertToNumPyArray(value);
+}
+
+// site types of the current structure.
+// New structure from an eval method invalidates the cache, because
+// setStructure may keep the same adapter instance.
+
+template <class T>
+const SiteTypeCache& getsitetypes(object self, object stru)
+{
+    T& obj = extract<T&>(self);
+    SiteTypeCachePtr cache =
+        getinstancecache<SiteTypeCache>(self, "_sitetypecache");
+    if (Py_None != stru.ptr())
+    {
+        obj.setStructure(stru);
+        cache->clear();
+    }
+    cache->update(obj.getStructure());
+    // the cache is kept alive by the instance dictionary
+    return *cache;
+}
+
+// support for the evalPartials method
+
+class PartialValueAccumulator
+{
+    public:
+
+        // constructor
+        PartialValueAccumulator(PairQuantity& pq,
+                const std::vector<int>& sitetypeindex, int ntypes) :
+            mpq(pq),
+            mvalue(PairQuantityAccess::valueOf(pq)),
+            msitetypeindex(sitetypeindex),
+            mntypes(ntypes),
+            mbuffers(ntypes * ntypes, PairQuantityAccess::valueOf(pq)),
+            mactive(-1)
+        { }
+
+        // methods
+        void operator()(const BaseBondGenerator& bnds, int summationscale)
+        {
+            int i = msitetypeindex[bnds.site0()];
+            int j = msitetypeindex[bnds.site1()];
+            if (i > j)  std::swap(i, j);
+            this->select(i * mntypes + j);
+            PairQuantityAccess::addPairContributionOf(
+                    mpq, bnds, summationscale);
+        }
+
+        /// swap the buffer for the type-pair index k into the PQ value
+        void select(int k)
+        {
+            if (k == mactive)  return;
+            this->release();
+            mvalue.swap(mbuffers[k]);
+            mactive = k;
+        }
+
+        /// restore the PQ value from before the last select call
+        void release()
+        {
+            if (mactive < 0)  return;
+            mvalue.swap(mbuffers[mactive]);
+            mactive = -1;
+        }
+
+    private:
+
+        // data
+        PairQuantity& mpq;
+        QuantityType& mvalue;
+        const std::vector<int>& msitetypeindex;
+        int mntypes;
+        std::vector<QuantityType> mbuffers;
+        int mactive;
+
+};
+
+
+template <class T>
+tuple evalpartials(object self, object stru)
+{
+    T& obj = extract<T&>(self);
+    const SiteTypeCache& sitetypes = getsitetypes<T>(self, stru);
+    PairQuantityAccess::resetValueOf(obj);
+    // sorted atom types and their indices for every site
+    const std::vector<std::string>& types = sitetypes.types();
+    const std::vector<int>& sitetypeindex = sitetypes.siteTypeIndex();
+    const int ntypes = types.size();
+    // one table lookup per atom type
+    const ScatteringFactorTablePtr& sftb = obj.getScatteringFactorTable();
+    std::vector<double> cf(sitetypes.typeAmounts());
+    double cftotal = 0.0;
+    for (int k = 0; k < ntypes; ++k)
+    {
+        cf[k] *= sftb->lookup(types[k]);
+        cftotal += cf[k];
+    }
+    // accumulate contributions from every type pair in a single sweep
+    PartialValueAccumulator acc(obj, sitetypeindex, ntypes);
+    forEachPairContribution(obj, acc);
+    // the sweep leaves the last type-pair buffer in the PQ value,
+    // swap it out to get the empty sum
+    acc.release();
+    // G(v) is an affine function of the summed value v, the zero value
+    // gives the baseline term B.  Contribution of a type pair k equals
+    // G(v_k) - (1 - w_k) * B, so that the contributions add up to the
+    // total PDF.  Partial PDFs are contributions normalized by weights.
+    QuantityType& value = PairQuantityAccess::valueOf(obj);
+    const QuantityType zerovalue = value;
+    const QuantityType gbase = obj.getPDF();
+    const int npts = gbase.size();
+    int szw[2] = {ntypes, ntypes};
+    NumPyArray_DoublePtr wts = createNumPyDoubleArray(2, szw);
+    int szg[3] = {ntypes, ntypes, npts};
+    NumPyArray_DoublePtr gpartials = createNumPyDoubleArray(3, szg);
+    const int szgtotal = ntypes * ntypes * npts;
+    std::fill(gpartials.second, gpartials.second + szgtotal, 0.0);
+    QuantityType totalvalue = zerovalue;
+    for (int i = 0; i < ntypes; ++i)
+    {
+        for (int j = i; j < ntypes; ++j)
+        {
+            double wij = (cftotal != 0.0) ?
+                (cf[i] * cf[j] / (cftotal * cftotal)) : 0.0;
+            wts.second[i * ntypes + j] = wij;
+            wts.second[j * ntypes + i] = wij;
+            acc.select(i * ntypes + j);
+            PairQuantityAccess::finishValueOf(obj);
+            std::transform(value.begin(), value.end(), totalvalue.begin(),
+                    totalvalue.begin(), std::plus<double>());
+            const double wk = (i == j) ? wij : (2 * wij);
+            if (wk == 0.0)  continue;
+            QuantityType gk = obj.getPDF();
+            assert(int(gk.size()) == npts);
+            double* gij = gpartials.second + (i * ntypes + j) * npts;
+            double* gji = gpartials.second + (j * ntypes + i) * npts;
+            for (int n = 0; n < npts; ++n)
+            {
+                gij[n] = (gk[n] - (1.0 - wk) * gbase[n]) / wk;
+                gji[n] = gij[n];
+            }
+        }
+    }
+    acc.release();
+    // the calculator value is the sum of all contributions
+    value = totalvalue;
+    resetPQEvaluator(obj);
+    tuple rv = make_tuple(tuple(types), wts.first, gpartials.first);
+    return rv;
+}
+
+// support for the evalTables method
+
+// scattering factor table with unit factors for any atom type,
+// used for accumulating pair sums without the scattering weights
+
+class UnitScatteringFactorTable : public ScatteringFactorTable
+{
+    public:
+
+        // methods
+        ScatteringFactorTablePtr create() const
+        {
+            return ScatteringFactorTablePtr(new UnitScatteringFactorTable);
+        }
+
+        ScatteringFactorTablePtr clone() const
+        {
+            return ScatteringFactorTablePtr(
+                    new UnitScatteringFactorTable(*this));
+        }
+
+        const std::string& type() const
+        {
+            static const std::string rv = "_unit";
+            return rv;
+        }
+
+        const std::string& radiationType() const
+        {
+            static const std::string rv = "";
+            return rv;
+        }
+
+        double standardLookup(const std::string&, double) const
+        {
+            return 1.0;
+        }
+
+};
+
+
+ScatteringFactorTablePtr extractscatteringfactortable(object tb)
+{
+    extract<std::string> tp(tb);
+    if (tp.check())  return ScatteringFactorTable::createByType(tp());
+    ScatteringFactorTablePtr rv = extract<ScatteringFactorTablePtr>(tb);
+    return rv;
+}
+
+// Q-spacing of the value array for the scattering factor lookup.
+// PDFCalculator sums pair terms with Q=0 scattering factors,
+// DebyePDFCalculator has the value array on the Q-grid.
+
+double valueqstep(const PDFCalculator&)
+{
+    return 0.0;
+}
+
+
+double valueqstep(const DebyePDFCalculator& obj)
+{
+    return obj.getDoubleAttr("qstep");
+}
+
+// Restore the qmax and scattering factor table of a PDF calculator
+// that are changed in evalTables and evalQmaxes.  If the guard is
+// not released by the restore call, for example due to an exception,
+// the destructor also zeros the internal value and resets the evaluator.
+
+template <class T>
+class PDFConfigGuard
+{
+    public:
+
+        // constructor
+        PDFConfigGuard(T& obj) :
+            mobj(obj),
+            mqmax(obj.getDoubleAttr("qmax")),
+            msftable(obj.getScatteringFactorTable()),
+            mactive(true)
+        { }
+
+        // destructor
+        ~PDFConfigGuard()
+        {
+            if (!mactive)  return;
+            this->restore();
+            PairQuantityAccess::resetValueOf(mobj);
+            resetPQEvaluator(mobj);
+        }
+
+        // methods
+        void restore()
+        {
+            mactive = false;
+            if (mqmax != mobj.getDoubleAttr("qmax"))
+            {
+                mobj.setDoubleAttr("qmax", mqmax);
+            }
+            if (msftable != mobj.getScatteringFactorTable())
+            {
+                mobj.setScatteringFactorTable(msftable);
+            }
+        }
+
+    private:
+
+        // data
+        T& mobj;
+        double mqmax;
+        ScatteringFactorTablePtr msftable;
+        bool mactive;
+
+};
+
+
+// finished value for the current scattering factor table from
+// the type-pair sums evaluated with unit scattering factors
+
+template <class T>
+void sumtablevalue(T& obj, const std::vector<std::string>& types,
+        const std::vector<QuantityType>& pairsums)
+{
+    PairQuantityAccess::resetValueOf(obj);
+    QuantityType& value = PairQuantityAccess::valueOf(obj);
+    const int nv = value.size();
+    const int ntypes = types.size();
+    // scattering factors for every type and value point, Q=0 terms
+    // are shared by all points when qstep is zero
+    const double qstep = valueqstep(obj);
+    const int nq = (qstep != 0.0) ? nv : std::min(nv, 1);
+    std::vector<double> qsf(nq);
+    for (int kq = 0; kq < nq; ++kq)  qsf[kq] = kq * qstep;
+    std::vector<double> sfq(ntypes * nq);
+    if (nq > 0)
+    {
+        lookupScatteringFactors(*obj.getScatteringFactorTable(),
+                types, &(qsf[0]), nq, &(sfq[0]));
+    }
+    for (int kq = 0; kq < nv; ++kq)
+    {
+        const int k = (nq == nv) ? kq : 0;
+        for (int i = 0; i < ntypes; ++i)
+        {
+            for (int j = i; j < ntypes; ++j)
+            {
+                const QuantityType& vij = pairsums[i * ntypes + j];
+                if (kq >= int(vij.size()))  continue;
+                value[kq] += sfq[i * nq + k] * sfq[j * nq + k] * vij[kq];
+            }
+        }
+    }
+    PairQuantityAccess::finishValueOf(obj);
+}
+
+
+template <class T>
+object evaltables(object self, object tables, object stru)
+{
+    T& obj = extract<T&>(self);
+    std::vector<ScatteringFactorTablePtr> sftables;
+    stl_input_iterator<object> tb(tables), tbend;
+    for (; tb != tbend; ++tb)
+    {
+        sftables.push_back(extractscatteringfactortable(*tb));
+    }
+    const SiteTypeCache& sitetypes = getsitetypes<T>(self, stru);
+    PDFConfigGuard<T> guard(obj);
+    // accumulate pair sums for every type pair with unit scattering
+    // factors.  The geometry and peak widths are thus evaluated once
+    // and only the type-pair weights differ among the tables.
+    obj.setScatteringFactorTable(
+            ScatteringFactorTablePtr(new UnitScatteringFactorTable));
+    PairQuantityAccess::resetValueOf(obj);
+    const std::vector<std::string>& types = sitetypes.types();
+    const std::vector<int>& sitetypeindex = sitetypes.siteTypeIndex();
+    const int ntypes = types.size();
+    PartialValueAccumulator acc(obj, sitetypeindex, ntypes);
+    forEachPairContribution(obj, acc);
+    std::vector<QuantityType> pairsums(ntypes * ntypes);
+    for (int k = 0; k < ntypes * ntypes; ++k)
+    {
+        acc.select(k);
+        pairsums[k].swap(PairQuantityAccess::valueOf(obj));
+    }
+    acc.release();
+    // combine the pair sums with the scattering factors of every table
+    std::vector<QuantityType> gtables;
+    for (int t = 0; t < int(sftables.size()); ++t)
+    {
+        obj.setScatteringFactorTable(sftables[t]);
+        sumtablevalue(obj, types, pairsums);
+        gtables.push_back(obj.getPDF());
+    }
+    // restore the original table and value
+    guard.restore();
+    sumtablevalue(obj, types, pairsums);
+    resetPQEvaluator(obj);
+    const int npts = obj.getPDF().size();
+    int sz[2] = {int(gtables.size()), npts};
+    NumPyArray_DoublePtr rv = createNumPyDoubleArray(2, sz);
+    for (int t = 0; t < int(gtables.size()); ++t)
+    {
+        assert(int(gtables[t].size()) == npts);
+        std::copy(gtables[t].begin(), gtables[t].end(),
+                rv.second + t * npts);
+    }
+    return rv.first;
+}
+
+// support for the sweep method
+
+class SweepValueAccumulator
+{
+    public:
+
+        // constructor
+        SweepValueAccumulator(const std::vector<PairQuantity*>& pqs,
+                const std::vector<double>& rmins,
+                const std::vector<double>& rmaxs) :
+            mpqs(pqs), mrmins(rmins), mrmaxs(rmaxs)
+        { }
+
+        // methods
+        void operator()(const BaseBondGenerator& bnds, int summationscale)
+        {
+            const double& d = bnds.distance();
+            for (size_t k = 0; k < mpqs.size(); ++k)
+            {
+                if (d < mrmins[k] || d > mrmaxs[k])  continue;
+                PairQuantityAccess::addPairContributionOf(
+                        *mpqs[k], bnds, summationscale);
+            }
+        }
+
+    private:
+
+        // data
+        const std::vector<PairQuantity*>& mpqs;
+        const std::vector<double>& mrmins;
+        const std::vector<double>& mrmaxs;
+
+};
+
+
+template <class T>
+void sweeppairs(const T& obj, object calcs)
+{
+    StructureAdapterConstPtr stru = obj.getStructure();
+    const int cntsites = stru->countSites();
+    BaseBondGeneratorPtr bnds = stru->createBondGenerator();
+    std::vector<PairQuantity*> pqs;
+    std::vector<double> rmins, rmaxs;
+    stl_input_iterator<object> pc(calcs), pcend;
+    for (; pc != pcend; ++pc)
+    {
+        T& pq = extract<T&>(*pc);
+        if (pq.getStructure()->countSites() != cntsites)
+        {
+            const char* emsg = "Calculators must have the same structure.";
+            throw std::invalid_argument(emsg);
+        }
+        PairQuantityAccess::configureBondGeneratorOf(pq, *bnds);
+        rmins.push_back(bnds->getRmin());
+        rmaxs.push_back(bnds->getRmax());
+        PairQuantityAccess::resetValueOf(pq);
+        pqs.push_back(&pq);
+    }
+    if (pqs.empty())  return;
+    // generate the union of the bond ranges
+    bnds->setRmin(*std::min_element(rmins.begin(), rmins.end()));
+    bnds->setRmax(*std::max_element(rmaxs.begin(), rmaxs.end()));
+    SweepValueAccumulator acc(pqs, rmins, rmaxs);
+    forEachPairContribution(obj, *bnds, acc);
+    for (size_t k = 0; k < pqs.size(); ++k)
+    {
+        PairQuantityAccess::finishValueOf(*pqs[k]);
+        resetPQEvaluator(*pqs[k]);
+    }
+}
+
+// support for the PDFCalculator.evalQmaxes method
+
+class PairValueAccumulator
+{
+    public:
+
+        // constructor
+        PairValueAccumulator(PairQuantity& pq) : mpq(pq)  { }
+
+        // methods
+        void operator()(const BaseBondGenerator& bnds, int summationscale)
+        {
+            PairQuantityAccess::addPairContributionOf(
+                    mpq, bnds, summationscale);
+        }
+
+    private:
+
+        // data
+        PairQuantity& mpq;
+
+};
+
+
+// raw PDFCalculator value for the current qmax
+
+QuantityType pdfcrawvalue(PDFCalculator& obj)
+{
+    PairQuantityAccess::resetValueOf(obj);
+    PairValueAccumulator acc(obj);
+    forEachPairContribution(obj, acc);
+    QuantityType rv;
+    rv.swap(PairQuantityAccess::valueOf(obj));
+    return rv;
+}
+
+
+// index of the first value point on the extended r-grid
+
+int pdfcvalueoffset(const PDFCalculator& obj)
+{
+    const double rstep = obj.getDoubleAttr("rstep");
+    int rv = int(floor(obj.getDoubleAttr("extendedrmin") / rstep));
+    return rv;
+}
+
+
+// finished PDFCalculator value for the current qmax.  Copy the raw
+// value from the shared widevalue when it covers the extended r-range.
+
+void pdfcqmaxvalue(PDFCalculator& obj, bool shared,
+        const QuantityType& widevalue, int wideoffset)
+{
+    PairQuantityAccess::resetValueOf(obj);
+    QuantityType& value = PairQuantityAccess::valueOf(obj);
+    const int offset = pdfcvalueoffset(obj) - wideoffset;
+    const bool covered = shared && offset >= 0 &&
+        offset + int(value.size()) <= int(widevalue.size());
+    if (covered)
+    {
+        std::copy(widevalue.begin() + offset,
+                widevalue.begin() + offset + value.size(),
+                value.begin());
+    }
+    else
+    {
+        QuantityType v = pdfcrawvalue(obj);
+        value.swap(v);
+    }
+    PairQuantityAccess::finishValueOf(obj);
+}
+
+
+object evalqmaxes(PDFCalculator& obj, object qmaxes, object stru)
+{
+    std::vector<double> qmx;
+    stl_input_iterator<double> q(qmaxes), qend;
+    qmx.assign(q, qend);
+    if (Py_None != stru.ptr())  obj.setStructure(stru);
+    PDFConfigGuard<PDFCalculator> guard(obj);
+    const double qmaxsaved = obj.getDoubleAttr("qmax");
+    // the raw values are shared only when the peak profile does not
+    // depend on qmax.  Evaluate them for the widest extended r-range,
+    // which includes the ranges of the other qmax values.
+    const bool shared = !obj.getPeakProfile()->hasDoubleAttr("qmax");
+    QuantityType widevalue;
+    int wideoffset = 0;
+    if (shared)
+    {
+        double qwide = qmaxsaved;
+        double widelength = obj.getDoubleAttr("extendedrmax") -
+            obj.getDoubleAttr("extendedrmin");
+        std::vector<double>::const_iterator qi = qmx.begin();
+        for (; qi != qmx.end(); ++qi)
+        {
+            obj.setDoubleAttr("qmax", *qi);
+            double length = obj.getDoubleAttr("extendedrmax") -
+                obj.getDoubleAttr("extendedrmin");
+            if (length <= widelength)  continue;
+            widelength = length;
+            qwide = *qi;
+        }
+        obj.setDoubleAttr("qmax", qwide);
+        widevalue = pdfcrawvalue(obj);
+        wideoffset = pdfcvalueoffset(obj);
+    }
+    // apply the termination stage for every qmax
+    std::vector<QuantityType> gqmaxes;
+    for (int t = 0; t < int(qmx.size()); ++t)
+    {
+        obj.setDoubleAttr("qmax", qmx[t]);
+        pdfcqmaxvalue(obj, shared, widevalue, wideoffset);
+        gqmaxes.push_back(obj.getPDF());
+    }
+    // restore the original qmax and value
+    guard.restore();
+    pdfcqmaxvalue(obj, shared, widevalue, wideoffset);
+    resetPQEvaluator(obj);
+    const int npts = obj.getPDF().size();
+    int sz[2] = {int(gqmaxes.size()), npts};
+    NumPyArray_DoublePtr rv = createNumPyDoubleArray(2, sz);
+    for (int t = 0; t < int(gqmaxes.size()); ++t)
+    {
+        assert(int(gqmaxes[t].size()) == npts);
+        std::copy(gqmaxes[t].begin(), gqmaxes[t].end(),
+                rv.second + t * npts);
+    }
+    return rv.first;
+}
+
+// support for the evalDerivatives method
+
+class PDFDerivativeAccumulator
+{
+    public:
+
+        // constructor
+        PDFDerivativeAccumulator(PDFCalculator& pc) :
+            mpc(pc),
+            mvalue(PairQuantityAccess::valueOf(pc)),
+            mpkf(pc.getPeakProfile()),
+            mpwm(pc.getPeakWidthModel()),
+            mjeong(false),
+            mmsdscale(0.0), mdelta1(0.0), mdelta2(0.0), mqbroad(0.0)
+        {
+            if ("gaussian" != mpkf->type())
+            {
+                const char* emsg = "evalDerivatives requires "
+                    "the 'gaussian' peakprofile.";
+                throw std::invalid_argument(emsg);
+            }
+            const std::string& pwmtype = mpwm->type();
+            if ("jeong" == pwmtype)
+            {
+                mjeong = true;
+                mdelta1 = mpwm->getDoubleAttr("delta1");
+                mdelta2 = mpwm->getDoubleAttr("delta2");
+                mqbroad = mpwm->getDoubleAttr("qbroad");
+            }
+            else if ("debye-waller" == pwmtype)  mmsdscale = 1.0;
+            else if ("constant" != pwmtype)
+            {
+                std::string emsg = "evalDerivatives does not support "
+                    "peak width model '" + pwmtype + "'.";
+                throw std::invalid_argument(emsg);
+            }
+            mrstep = pc.getDoubleAttr("rstep");
+            mrcalclo = floor(pc.getDoubleAttr("extendedrmin") / mrstep) *
+                mrstep;
+            mscratch.assign(mvalue.size(), 0.0);
+            StructureAdapterConstPtr stru = pc.getStructure();
+            const int cntsites = stru->countSites();
+            manisotropy.resize(cntsites);
+            for (int i = 0; i < cntsites; ++i)
+            {
+                manisotropy[i] = stru->siteAnisotropy(i);
+            }
+            mdvalue.assign(NDERIVS * cntsites, mscratch);
+        }
+
+        // methods
+        void operator()(const BaseBondGenerator& bnds, int summationscale)
+        {
+            // evaluate the pair contribution in the scratch buffer
+            const double dist = bnds.distance();
+            const double fwhm = mpwm->calculate(bnds);
+            const int npts = mvalue.size();
+            const int ilo = std::max(0, int(floor(
+                        (dist + mpkf->xboundlo(fwhm) - mrcalclo) / mrstep)));
+            const int ihi = std::min(npts, 1 + int(ceil(
+                        (dist + mpkf->xboundhi(fwhm) - mrcalclo) / mrstep)));
+            mvalue.swap(mscratch);
+            PairQuantityAccess::addPairContributionOf(
+                    mpc, bnds, summationscale);
+            mvalue.swap(mscratch);
+            if (fwhm > 0.0 && dist > 0.0)
+            {
+                this->addDerivatives(bnds, fwhm, ilo, ihi);
+            }
+            for (int i = ilo; i < ihi; ++i)
+            {
+                mvalue[i] += mscratch[i];
+                mscratch[i] = 0.0;
+            }
+        }
+
+        /// array of the accumulated derivatives
+        std::vector<QuantityType>& dvalue()  { return mdvalue; }
+
+        /// number of derivatives per site, 3 coordinates and 6 Uij
+        static const int NDERIVS = 9;
+
+    private:
+
+        void addDerivatives(const BaseBondGenerator& bnds,
+                double fwhm, int ilo, int ihi)
+        {
+            using namespace std;
+            const int i0 = bnds.site0();
+            const int i1 = bnds.site1();
+            const double dist = bnds.distance();
+            const double msd = bnds.msd();
+            const R3::Vector& r01 = bnds.r01();
+            double u[R3::Ndim];
+            for (int a = 0; a < R3::Ndim; ++a)  u[a] = r01[a] / dist;
+            // Gaussian variance and its dependence on msd and distance
+            const double fwhmtosigma = 1.0 / (2 * sqrt(2 * M_LN2));
+            const double s2 = pow(fwhm * fwhmtosigma, 2);
+            double s2dmsd = mmsdscale;
+            double s2ddist = 0.0;
+            if (mjeong)
+            {
+                s2dmsd = 1.0 - mdelta1 / dist - mdelta2 / (dist * dist) +
+                    pow(mqbroad * dist, 2);
+                s2ddist = msd * (mdelta1 / (dist * dist) +
+                        2 * mdelta2 / (dist * dist * dist) +
+                        2 * mqbroad * mqbroad * dist);
+            }
+            // gradient of msd with respect to r01 from anisotropic sites
+            double msddr01[R3::Ndim] = {0.0, 0.0, 0.0};
+            const R3::Matrix* Us[2] =
+                {&bnds.Ucartesian0(), &bnds.Ucartesian1()};
+            const bool aniso[2] = {manisotropy[i0], manisotropy[i1]};
+            for (int s = 0; s < 2; ++s)
+            {
+                if (!aniso[s])  continue;
+                const R3::Matrix& U = *(Us[s]);
+                double Uu[R3::Ndim];
+                double uUu = 0.0;
+                for (int a = 0; a < R3::Ndim; ++a)
+                {
+                    Uu[a] = U(a, 0) * u[0] + U(a, 1) * u[1] + U(a, 2) * u[2];
+                    uUu += u[a] * Uu[a];
+                }
+                for (int a = 0; a < R3::Ndim; ++a)
+                {
+                    msddr01[a] += 2.0 / dist * (Uu[a] - uUu * u[a]);
+                }
+            }
+            // derivatives of msd with respect to U11, U22, U33, U12, U13, U23
+            const double msddU[6] = {u[0] * u[0], u[1] * u[1], u[2] * u[2],
+                2 * u[0] * u[1], 2 * u[0] * u[2], 2 * u[1] * u[2]};
+            QuantityType** dx0 = &mdvaluep[0];
+            for (int a = 0; a < NDERIVS; ++a)
+            {
+                mdvaluep[a] = &mdvalue[NDERIVS * i0 + a];
+                mdvaluep[NDERIVS + a] = &mdvalue[NDERIVS * i1 + a];
+            }
+            QuantityType** dx1 = dx0 + NDERIVS;
+            for (int i = ilo; i < ihi; ++i)
+            {
+                const double h = mscratch[i];
+                if (h == 0.0)  continue;
+                const double x = mrcalclo + i * mrstep - dist;
+                // derivatives of the Gaussian over its center and variance
+                const double hdd = x / s2 * h;
+                const double hds2 = 0.5 * (x * x / (s2 * s2) - 1.0 / s2) * h;
+                const double gdist = hdd + s2ddist * hds2;
+                const double gmsd = s2dmsd * hds2;
+                for (int a = 0; a < R3::Ndim; ++a)
+                {
+                    double gx = gdist * u[a] + gmsd * msddr01[a];
+                    (*dx1[a])[i] += gx;
+                    (*dx0[a])[i] -= gx;
+                }
+                if (gmsd == 0.0)  continue;
+                for (int b = 0; b < 6; ++b)
+                {
+                    double gu = gmsd * msddU[b];
+                    (*dx0[R3::Ndim + b])[i] += gu;
+                    (*dx1[R3::Ndim + b])[i] += gu;
+                }
+            }
+        }
+
+        // data
+        PDFCalculator& mpc;
+        QuantityType& mvalue;
+        PeakProfilePtr mpkf;
+        PeakWidthModelPtr mpwm;
+        bool mjeong;
+        double mmsdscale;
+        double mdelta1;
+        double mdelta2;
+        double mqbroad;
+        double mrstep;
+        double mrcalclo;
+        QuantityType mscratch;
+        std::vector<bool> manisotropy;
+        std::vector<QuantityType> mdvalue;
+        QuantityType* mdvaluep[2 * NDERIVS];
+
+};
+
+
+tuple evalderivatives(PDFCalculator& obj, object stru)
+{
+    if (Py_None != stru.ptr())  obj.setStructure(stru);
+    PairQuantityAccess::resetValueOf(obj);
+    PDFDerivativeAccumulator acc(obj);
+    forEachPairContribution(obj, acc);
+    // the derivatives are given by the linear part of the PDF
+    // transformation, i.e., G(dv) - G(0).
+    QuantityType& value = PairQuantityAccess::valueOf(obj);
+    QuantityType totalvalue(value.size(), 0.0);
+    value.swap(totalvalue);
+    const QuantityType gbase = obj.getPDF();
+    const int npts = gbase.size();
+    const int cntsites = obj.getStructure()->countSites();
+    const int nderivs = PDFDerivativeAccumulator::NDERIVS;
+    int szx[3] = {cntsites, R3::Ndim, npts};
+    NumPyArray_DoublePtr dgdx = createNumPyDoubleArray(3, szx);
+    int szu[3] = {cntsites, nderivs - R3::Ndim, npts};
+    NumPyArray_DoublePtr dgdu = createNumPyDoubleArray(3, szu);
+    double* px = dgdx.second;
+    double* pu = dgdu.second;
+    std::vector<QuantityType>& dvalue = acc.dvalue();
+    for (int k = 0; k < int(dvalue.size()); ++k)
+    {
+        value.swap(dvalue[k]);
+        PairQuantityAccess::finishValueOf(obj);
+        QuantityType gk = obj.getPDF();
+        value.swap(dvalue[k]);
+        QuantityType().swap(dvalue[k]);
+        double*& pk = (k % nderivs < R3::Ndim) ? px : pu;
+        for (int n = 0; n < npts; ++n, ++pk)  *pk = gk[n] - gbase[n];
+    }
+    assert(px == dgdx.second + cntsites * R3::Ndim * npts);
+    // restore the total value
+    value.swap(totalvalue);
+    PairQuantityAccess::finishValueOf(obj);
+    resetPQEvaluator(obj);
+    tuple rv = make_tuple(dgdx.first, dgdu.first);
+    return rv;
+}
+
+// support for the DebyePDFCalculator.evalHistogram method
+
+DebyeHistogram::DebyeKernel getdebyekernel(object self)
+{
+    std::string kname = extract<std::string>(self.attr("histogramkernel"));
+    if ("simd" == kname)  return DebyeHistogram::SIMD;
+    if ("recurrence" == kname)  return DebyeHistogram::RECURRENCE;
+    if ("direct" == kname)  return DebyeHistogram::DIRECT;
+    std::string emsg = "Invalid histogramkernel '" + kname + "'.";
+    throw std::invalid_argument(emsg);
+}
+
+// cheap digest of the site data that affect the histogram sums
+
+std::size_t structuredigest(const StructureAdapter& stru)
+{
+    std::size_t rv = 0;
+    const int cntsites = stru.countSites();
+    boost::hash_combine(rv, cntsites);
+    for (int i = 0; i < cntsites; ++i)
+    {
+        boost::hash_combine(rv, stru.siteAtomType(i));
+        const R3::Vector& xyz = stru.siteCartesianPosition(i);
+        const R3::Matrix& uij = stru.siteCartesianUij(i);
+        for (int k = 0; k < R3::Ndim; ++k)
+        {
+            boost::hash_combine(rv, xyz[k]);
+            for (int l = k; l < R3::Ndim; ++l)
+            {
+                boost::hash_combine(rv, uij(k, l));
+            }
+        }
+        boost::hash_combine(rv, stru.siteOccupancy(i));
+        boost::hash_combine(rv, stru.siteAnisotropy(i));
+        boost::hash_combine(rv, stru.siteMultiplicity(i));
+    }
+    return rv;
+}
+
+// identifier of the calculator state that affects the histogram sums.
+// The structure is identified by the adapter instance, which is held
+// in the cache by a weak pointer, and by a digest of its site data.
+
+std::string debyehistogramkey(const DebyePDFCalculator& obj,
+        double binwidth, double msdstep, DebyeHistogram::DebyeKernel kernel)
+{
+    std::ostringstream out;
+    out.precision(17);
+    out << kernel << ' ' << binwidth << ' ' << msdstep << ' ' <<
+        obj.getDoubleAttr("qstep") << ' ' <<
+        obj.getDoubleAttr("qmin") << ' ' <<
+        obj.getDoubleAttr("qmax") << ' ' <<
+        obj.getDoubleAttr("debyeprecision") << ' ' <<
+        obj.getDoubleAttr("rmin") << ' ' <<
+        obj.getDoubleAttr("rmax") << ' ' <<
+        obj.getDoubleAttr("maxextension") << '\n';
+    const PeakWidthModelPtr& pwm = obj.getPeakWidthModel();
+    out << pwm->type();
+    std::set<std::string> pwmattrs = pwm->namesOfDoubleAttributes();
+    std::set<std::string>::const_iterator nm = pwmattrs.begin();
+    for (; nm != pwmattrs.end(); ++nm)
+    {
+        out << ' ' << *nm << '=' << pwm->getDoubleAttr(*nm);
+    }
+    out << '\n' << std::hex << structuredigest(*obj.getStructure());
+    return out.str();
+}
+
+
+DebyeHistogramCachePtr getdebyehistogramcache(object self)
+{
+    const char* cacheattr = "_debyehistogramcache";
+    return getinstancecache<DebyeHistogramCache>(self, cacheattr);
+}
+
+
+// add type-pair sums weighted by the scattering factors sfq
+// for Q-points from kqfirst to value
+
+template <class T>
+void addtypepairsums(QuantityType& value, const DebyeHistogram& hist,
+        const std::vector< std::vector<T> >& sums,
+        const std::vector<double>& sfq, int kqfirst)
+{
+    const int ntypes = hist.types().size();
+    const int nqsf = value.size() - kqfirst;
+    for (int i = 0; i < ntypes; ++i)
+    {
+        for (int j = i; j < ntypes; ++j)
+        {
+            const std::vector<T>& sk = sums[hist.typePairIndex(i, j)];
+            for (int k = 0; k < nqsf; ++k)
+            {
+                const int kq = kqfirst + k;
+                value[kq] += sfq[i * nqsf + k] * sfq[j * nqsf + k] * sk[kq];
+            }
+        }
+    }
+}
+
+
+object evalhistogram(object self, object stru,
+        double binwidth, double msdstep)
+{
+    DebyePDFCalculator& obj = extract<DebyePDFCalculator&>(self);
+    if (Py_None != stru.ptr())  obj.setStructure(stru);
+    PairQuantityAccess::resetValueOf(obj);
+    QuantityType& value = PairQuantityAccess::valueOf(obj);
+    const double qstep = obj.getDoubleAttr("qstep");
+    const double qmin = obj.getDoubleAttr("qmin");
+    const int kqlo = (qstep > 0.0) ? int(ceil(qmin / qstep)) : 0;
+    const int nq = value.size();
+    // rebuild histogram sums unless cached for the same state
+    DebyeHistogramCachePtr cache = getdebyehistogramcache(self);
+    DebyeHistogram::DebyeKernel kernel = getdebyekernel(self);
+    const bool singleprecision = issingleprecision(self);
+    std::string key = debyehistogramkey(obj, binwidth, msdstep, kernel);
+    key.insert(0, singleprecision ? "f32 " : "f64 ");
+    if (cache->structure.lock() != obj.getStructure() || key != cache->key)
+    {
+        cache->key.clear();
+        cache->structure.reset();
+        cache->sums.clear();
+        cache->sumsf.clear();
+        cache->histogram.build(obj, *obj.getPeakWidthModel(),
+                binwidth, msdstep);
+        const double precision = obj.getDoubleAttr("debyeprecision");
+        if (singleprecision)
+        {
+            cache->histogram.debyeSums(cache->sumsf, qstep, kqlo, nq,
+                    precision, kernel);
+        }
+        else
+        {
+            cache->histogram.debyeSums(cache->sums, qstep, kqlo, nq,
+                    precision, kernel);
+        }
+        cache->key = key;
+        cache->structure = obj.getStructure();
+    }
+    const DebyeHistogram& hist = cache->histogram;
+    // combine the type-pair sums with the scattering factors
+    const std::vector<std::string>& types = hist.types();
+    const int ntypes = types.size();
+    const int kqfirst = std::min(nq, std::max(0, kqlo));
+    const int nqsf = nq - kqfirst;
+    std::vector<double> qsf(nqsf);
+    for (int k = 0; k < nqsf; ++k)  qsf[k] = (kqfirst + k) * qstep;
+    std::vector<double> sfq(ntypes * nqsf);
+    if (nqsf > 0)
+    {
+        lookupScatteringFactors(*obj.getScatteringFactorTable(),
+                types, &(qsf[0]), nqsf, &(sfq[0]));
+    }
+    if (singleprecision)
+    {
+        addtypepairsums(value, hist, cache->sumsf, sfq, kqfirst);
+    }
+    else
+    {
+        addtypepairsums(value, hist, cache->sums, sfq, kqfirst);
+    }
+    PairQuantityAccess::finishValueOf(obj);
+    resetPQEvaluator(obj);
+    object rv = convertToNumPyArray(value, singleprecision);
+    return rv;
+}
+
+// support for the native copy method
+
+template <class T>
+void clonepdfcomponents(T& obj, object src, object pqobj)
+{
+    ScatteringFactorTablePtr sftb = obj.getScatteringFactorTable();
+    // Python-derived tables can change without the wrapped mutators
+    if (ispythonderived(sftb.get()))
+    {
+        obj.setScatteringFactorTable(sftb->clone());
+    }
+    else
+    {
+        SharedTableRegistry<ScatteringFactorTable>::instance().share(
+                src, pqobj, sftableowneraccess());
+    }
+    obj.setPeakWidthModel(obj.getPeakWidthModel()->clone());
+    std::set<std::string> etps = obj.usedEnvelopeTypes();
+    std::set<std::string>::const_iterator tpi;
+    for (tpi = etps.begin(); tpi != etps.end(); ++tpi)
+    {
+        obj.addEnvelope(obj.getEnvelopeByType(*tpi)->clone());
+    }
+    // instance caches are private to each calculator
+    dict d = extract<dict>(pqobj.attr("__dict__"));
+    const char* cacheattrs[] = {"_sitetypecache", "_debyehistogramcache"};
+    for (int i = 0; i < 2; ++i)
+    {
+        if (d.has_key(cacheattrs[i]))  api::delitem(d, cacheattrs[i]);
+    }
+}
+
+
+void clonedebyepdfcalculator(object src, object pqobj)
+{
+    DebyePDFCalculator& obj = extract<DebyePDFCalculator&>(pqobj);
+    clonepdfcomponents(obj, src, pqobj);
+}
+
+
+void clonepdfcalculator(object src, object pqobj)
+{
+    PDFCalculator& obj = extract<PDFCalculator&>(pqobj);
+    clonepdfcomponents(obj, src, pqobj);
+    obj.setPeakProfile(obj.getPeakProfile()->clone());
+    obj.setBaseline(obj.getBaseline()->clone());
+}
+
 // wrap shared methods and attributes of PDFCalculators
 
 template <class C>
@@ -273,13 +1661,17 @@ C& wrap_PDFCommon(C& boostpythonclass)
     typedef typename C::wrapped_type W;
     boostpythonclass
         // result vectors
-        .add_property("pdf", getPDF_asarray<W>,
+        .def("eval", evalarray<W>, bp::arg("stru")=object(),
+                doc_PDFCommon_eval)
+        .add_property("value", getvaluearray<W>,
+                doc_PDFCommon_value)
+        .add_property("pdf", getpdfarray<W>,
                 doc_PDFCommon_pdf)
-        .add_property("rdf", getRDF_asarray<W>,
+        .add_property("rdf", getrdfarray<W>,
                 doc_PDFCommon_rdf)
         .add_property("rgrid", getRgrid_asarray<W>,
                 doc_PDFCommon_rgrid)
-        .add_property("fq", getF_asarray<W>,
+        .add_property("fq", getfarray<W>,
                 doc_PDFCommon_fq)
         .add_property("qgrid", getQgrid_asarray<W>,
                 doc_PDFCommon_qgrid)
@@ -298,17 +1690,69 @@ C& wrap_PDFCommon(C& boostpythonclass)
                 bp::arg("tp"), doc_PDFCommon_getEnvelope)
         .def("clearEnvelopes", &W::clearEnvelopes,
                 doc_PDFCommon_clearEnvelopes)
+        // partial PDFs
+        .def("evalPartials", evalpartials<W>,
+                bp::arg("stru")=object(),
+                doc_PDFCommon_evalPartials)
+        .def("evalTables", evaltables<W>,
+                (bp::arg("tables"), bp::arg("stru")=object()),
+                doc_PDFCommon_evalTables)
+        .def("_sweepPairs", sweeppairs<W>,
+                bp::arg("calcs"), doc_PDFCommon__sweepPairs)
+        // parallel data in the selected precision
+        .def("_getParallelData", getparalleldata<W>,
+                doc_PDFCommon__getParallelData)
+        .def("_mergeParallelData", mergeparalleldata<W>,
+                (bp::arg("pdata"), bp::arg("ncpu")),
+                doc_PDFCommon__mergeParallelData)
+        .def("_reduceParallelData", reduceparalleldata<W>,
+                bp::arg("pdatalist"),
+                doc_PDFCommon__reduceParallelData)
+        .def("_getParallelValue", getparallelvalue<W>,
+                doc_PDFCommon__getParallelValue)
+        .def("_mergeParallelValue", mergeparallelvalue<W>,
+                (bp::arg("pvalue"), bp::arg("finish")),
+                doc_PDFCommon__mergeParallelValue)
+        .def("_reduceParallelValue", reduceparallelvalue,
+                bp::arg("pvaluelist"),
+                doc_PDFCommon__reduceParallelValue)
+        .staticmethod("_reduceParallelValue")
         ;
     return boostpythonclass;
 }
 
-// local helper for converting python object to a quantity type
+// sine transform of exact length npad with the shared plan cache
+
+QuantityType fftexact(const QuantityType& x, double step, double xmin,
+        int npad, double scale)
+{
+    static SineTransform fftplans;
+    if (step <= 0)
+    {
+        const char* emsg = "Grid step must be positive.";
+        throw std::invalid_argument(emsg);
+    }
+    const int offset = SineTransform::gridOffset(step, xmin);
+    if (offset < 0 || npad < offset + int(x.size()))
+    {
+        const char* emsg = "npad is smaller than the input grid.";
+        throw std::invalid_argument(emsg);
+    }
+    QuantityType rv(npad);
+    SineTransformPlan::WorkBuffer work;
+    fftplans.getPlan(npad)->transform(x.empty() ? 0 : &(x[0]),
+            x.size(), offset, scale * step, &(rv[0]), work);
+    return rv;
+}
+
 
-tuple fftftog_array_step(object f, double qstep, double qmin)
+tuple fftftog_array_step(object f, double qstep, double qmin, int npad)
 {
     QuantityType f0;
     const QuantityType& f1 = extractQuantityType(f, f0);
-    QuantityType g = fftftog(f1, qstep, qmin);
+    QuantityType g = (npad > 0) ?
+        fftexact(f1, qstep, qmin, npad, 2 / M_PI) :
+        fftftog(f1, qstep, qmin);
     object ga = convertToNumPyArray(g);
     double qmaxpad = g.size() * qstep;
     double rstep = (qmaxpad > 0) ? (M_PI / qmaxpad) : 0.0;
@@ -316,11 +1760,13 @@ tuple fftftog_array_step(object f, double qstep, double qmin)
 }
 
 
-tuple fftgtof_array_step(object g, double rstep, double rmin)
+tuple fftgtof_array_step(object g, double rstep, double rmin, int npad)
 {
     QuantityType g0;
     const QuantityType& g1 = extractQuantityType(g, g0);
-    QuantityType f = fftgtof(g1, rstep, rmin);
+    QuantityType f = (npad > 0) ?
+        fftexact(g1, rstep, rmin, npad, 1.0) :
+        fftgtof(g1, rstep, rmin);
     object fa = convertToNumPyArray(f);
     double rmaxpad = f.size() * rstep;
     double qstep = (rmaxpad > 0) ? (M_PI / rmaxpad) : 0.0;
@@ -334,6 +1780,7 @@ tuple fftgtof_array_step(object g, double rstep, double rmin)
 void wrap_PDFCalculators()
 {
     using namespace nswrap_PDFCalculators;
+    using boost::noncopyable;
     namespace bp = boost::python;
 
     // DebyePDFCalculator
@@ -345,6 +1792,13 @@ void wrap_PDFCalculators()
                 doc_DebyePDFCalculator_setOptimumQstep)
         .def("isOptimumQstep", &DebyePDFCalculator::isOptimumQstep,
                 doc_DebyePDFCalculator_isOptimumQstep)
+        .def("evalHistogram", evalhistogram,
+                (bp::arg("stru")=object(), bp::arg("binwidth")=0.0004,
+                 bp::arg("msdstep")=1e-4),
+                doc_DebyePDFCalculator_evalHistogram)
+        .def("copy",
+                pqclone<DebyePDFCalculator, clonedebyepdfcalculator>,
+                doc_PairQuantity_nativecopy)
         .def_pickle(SerializationPickleSuite<DebyePDFCalculator>())
         ;
 
@@ -363,15 +1817,38 @@ void wrap_PDFCalculators()
                 getbaseline,
                 setbaseline<PDFCalculator,PDFBaseline>,
                 doc_PDFCalculator_baseline)
+        // analytical derivatives
+        .def("evalDerivatives", evalderivatives,
+                bp::arg("stru")=object(),
+                doc_PDFCalculator_evalDerivatives)
+        .def("evalQmaxes", evalqmaxes,
+                (bp::arg("qmaxes"), bp::arg("stru")=object()),
+                doc_PDFCalculator_evalQmaxes)
+        .def("copy", pqclone<PDFCalculator, clonepdfcalculator>,
+                doc_PairQuantity_nativecopy)
         .def_pickle(SerializationPickleSuite<PDFCalculator>())
         ;
 
+    // opaque storage for the evalHistogram cache
+    class_<DebyeHistogramCache, DebyeHistogramCachePtr, noncopyable>(
+            "_DebyeHistogramCache")
+        .def_pickle(EmptyCachePickleSuite<DebyeHistogramCache>())
+        ;
+
+    // opaque storage for the per-site atom types
+    class_<SiteTypeCache, SiteTypeCachePtr, noncopyable>(
+            "_SiteTypeCache")
+        .def_pickle(EmptyCachePickleSuite<SiteTypeCache>())
+        ;
+
     // FFT functions
     def("fftftog", fftftog_array_step,
-            (bp::arg("f"), bp::arg("qstep"), bp::arg("qmin")=0.0),
+            (bp::arg("f"), bp::arg("qstep"), bp::arg("qmin")=0.0,
+             bp::arg("npad")=0),
             doc_fftftog);
     def("fftgtof", fftgtof_array_step,
-            (bp::arg("g"), bp::arg("rstep"), bp::arg("rmin")=0.0),
+            (bp::arg("g"), bp::arg("rstep"), bp::arg("rmin")=0.0,
+             bp::arg("npad")=0),
             doc_fftgtof);
 
     // inject pickling methods for PDFBaseline and PDFEnvelope classes
@@ -157,14 +157,14 @@ class PDFEnvelopeWrap :
 
 std::string envelope_tostring(PDFEnvelopePtr obj)
 {
-    return diffpy::serialization_tostring(obj);
+    return pickle_tostring(obj);
 }
 
 
 PDFEnvelopePtr envelope_fromstring(std::string content)
 {
     PDFEnvelopePtr rv;
-    diffpy::serialization_fromstring(rv, content);
+    pickle_fromstring(rv, content);
     return rv;
 }
 
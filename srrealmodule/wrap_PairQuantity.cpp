@@ -38,6 +38,8 @@
 
 #include "srreal_converters.hpp"
 #include "srreal_pickling.hpp"
+#include "srreal_pqaccess.hpp"
+#include "srreal_symbols.hpp"
 
 namespace srrealmodule {
 namespace nswrap_PairQuantity {
@@ -79,6 +81,20 @@ const char* doc_BasePairQuantity__getParallelData = "\
 Return raw results string from a parallel job.\n\
 ";
 
+const char* doc_BasePairQuantity__reduceParallelData = "\
+Combine raw results strings from several parallel jobs into one.\n\
+This resets the internal values, adds every pdata with the\n\
+_executeParallelMerge method and returns _getParallelData of the sum.\n\
+Parallel jobs can thus sum their partial results pairwise, so that\n\
+the master merges a single string.\n\
+\n\
+pdatalist -- sequence of raw data strings from _getParallelData\n\
+            of the parallel jobs for the same structure.\n\
+\n\
+Return raw results string to be merged with _mergeParallelData\n\
+for ncpu=1.  This changes the internal values of this instance.\n\
+";
+
 const char* doc_BasePairQuantity_setStructure = "\
 Assign structure to be evaluated without executing the calculation.\n\
 This zeros the internal values array and updates the pair mask data.\n\
@@ -167,10 +183,12 @@ The pair masking is exclusively based either on site indices\n\
 or atom types.  This function applies type-based masking and\n\
 cancels any previous index-based masks.\n\
 \n\
-tpi  -- first atom type in the pair, string or an iterable of strings.\n\
-        When 'all' or 'ALL', tpi refers to all sites in the structure.\n\
-tpj  -- second atom type in the pair, string or an iterable of strings.\n\
-        When 'all' or 'ALL', tpj refers to all sites in the structure.\n\
+tpi  -- first atom type in the pair, string, integer type ID from\n\
+        atomTypeId or an iterable of these.  When 'all' or 'ALL',\n\
+        tpi refers to all sites in the structure.\n\
+tpj  -- second atom type in the pair, string, integer type ID from\n\
+        atomTypeId or an iterable of these.  When 'all' or 'ALL',\n\
+        tpj refers to all sites in the structure.\n\
 mask -- mask for the atom types pair.\n\
         True if included, False if excluded.\n\
 others -- optional mask applied to all other pairs.  Ignored when None.\n\
@@ -390,20 +408,29 @@ std::vector<int> parsepairindex(python::object i)
     return rv;
 }
 
-// support string iterables in setTypeMask
+// support type IDs and iterables in setTypeMask
+
+std::string pairtypesymbol(python::object smbl)
+{
+    python::extract<int> getid(smbl);
+    if (getid.check())  return internedSymbol(getid());
+    std::string rv = python::extract<std::string>(smbl);
+    return rv;
+}
+
 
 std::vector<std::string> parsepairtypes(
         python::extract<std::string>& getsmbli, python::object smbli)
 {
     std::vector<std::string> rv;
-    if (getsmbli.check())
+    if (getsmbli.check() || python::extract<int>(smbli).check())
     {
-        rv.push_back(getsmbli());
+        rv.push_back(pairtypesymbol(smbli));
     }
     else
     {
-        python::stl_input_iterator<std::string> first(smbli), last;
-        rv.assign(first, last);
+        python::stl_input_iterator<python::object> first(smbli), last;
+        for (; first != last; ++first)  rv.push_back(pairtypesymbol(*first));
     }
     return rv;
 }
@@ -471,6 +498,19 @@ void set_type_mask(PairQuantity& obj,
 }
 
 
+// sum raw results of parallel jobs using the virtual merge method
+
+std::string reduce_parallel_data(PairQuantity& obj, python::object pdatalist)
+{
+    python::stl_input_iterator<std::string> first(pdatalist), last;
+    PairQuantityAccess::resetValueOf(obj);
+    for (; first != last; ++first)
+    {
+        PairQuantityAccess::executeParallelMergeOf(obj, *first);
+    }
+    return obj.getParallelData();
+}
+
 // provide a copy method for convenient deepcopy of the object
 
 python::object pqcopy(python::object pqobj)
@@ -677,6 +717,9 @@ void wrap_PairQuantity()
                 doc_BasePairQuantity__mergeParallelData)
         .def("_getParallelData", &PairQuantity::getParallelData,
                 doc_BasePairQuantity__getParallelData)
+        .def("_reduceParallelData", reduce_parallel_data,
+                python::arg("pdatalist"),
+                doc_BasePairQuantity__reduceParallelData)
         .def("setStructure", &PairQuantity::setStructure<object>,
                 python::arg("stru"),
                 doc_BasePairQuantity_setStructure)
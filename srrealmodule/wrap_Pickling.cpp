@@ -0,0 +1,81 @@
+/*****************************************************************************
+*
+* diffpy.srreal     by DANSE Diffraction group
+*                   Simon J. L. Billinge
+*                   (c) 2013 Trustees of the Columbia University
+*                   in the City of New York.  All rights reserved.
+*
+* File coded by:    Pavol Juhas
+*
+* See AUTHORS.txt for a list of people who contributed.
+* See LICENSE.txt for license information.
+*
+******************************************************************************
+*
+* Bindings to the codec selection of the pickle content strings.
+*
+*****************************************************************************/
+
+#include <boost/python.hpp>
+#include <string>
+#include <vector>
+
+#include "srreal_pickling.hpp"
+
+namespace srrealmodule {
+namespace nswrap_Pickling {
+
+using namespace boost::python;
+
+// docstrings ----------------------------------------------------------------
+
+const char* doc__pickleCodecs = "\
+Return a tuple of pickle codecs available in this build.\n\
+The 'raw' codec is always present, 'lz4' needs a build with lz4=True.\n\
+";
+
+const char* doc__getPickleCodec = "\
+Return the codec used for new pickles of the C++ objects.\n\
+";
+
+const char* doc__setPickleCodec = "\
+Select codec for new pickles of the C++ objects.\n\
+\n\
+codec    -- 'raw' stores uncompressed archives, 'auto' compresses\n\
+            large archives with LZ4 when that makes them smaller and\n\
+            'lz4' compresses every archive.  The default is 'raw'.\n\
+\n\
+Pickles of any codec available in the build can be loaded regardless\n\
+of this setting.  Raise ValueError for unknown or unavailable codec.\n\
+";
+
+// wrappers ------------------------------------------------------------------
+
+tuple picklecodecs_astuple()
+{
+    std::vector<std::string> codecs = pickle_codecs();
+    list rv;
+    std::vector<std::string>::const_iterator c = codecs.begin();
+    for (; c != codecs.end(); ++c)  rv.append(*c);
+    return tuple(rv);
+}
+
+}   // namespace nswrap_Pickling
+
+// Wrapper definition --------------------------------------------------------
+
+void wrap_Pickling()
+{
+    using namespace nswrap_Pickling;
+
+    def("_pickleCodecs", picklecodecs_astuple, doc__pickleCodecs);
+    def("_getPickleCodec", get_pickle_codec,
+            return_value_policy<copy_const_reference>(),
+            doc__getPickleCodec);
+    def("_setPickleCodec", set_pickle_codec,
+            arg("codec"), doc__setPickleCodec);
+}
+
+}   // namespace srrealmodule
+
+// End of file
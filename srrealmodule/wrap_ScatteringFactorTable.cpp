@@ -18,6 +18,9 @@
 *****************************************************************************/
 
 #include <boost/python.hpp>
+#include <boost/python/stl_iterator.hpp>
+#include <map>
+#include <utility>
 
 #include <diffpy/srreal/ScatteringFactorTable.hpp>
 #include <diffpy/srreal/SFTXray.hpp>
@@ -26,7 +29,10 @@
 #include <diffpy/srreal/SFTElectronNumber.hpp>
 
 #include "srreal_converters.hpp"
+#include "srreal_instancecache.hpp"
 #include "srreal_pickling.hpp"
+#include "srreal_sflookup.hpp"
+#include "srreal_symbols.hpp"
 
 namespace srrealmodule {
 namespace nswrap_ScatteringFactorTable {
@@ -50,6 +56,9 @@ A derived class has to overload the following methods:\n\
 \n\
 Derived class can be added to the global registry of ScatteringFactorTable\n\
 types by calling the _registerThisType method with any instance.\n\
+The results of _standardLookup are memoized for every symbol and Q\n\
+until the table ticker changes, for example in setCustomAs or resetAll.\n\
+Use _resetLookupCache when they become invalid otherwise.\n\
 ";
 
 const char* doc_ScatteringFactorTable___init__ = "\
@@ -92,6 +101,29 @@ Q    -- Q value in inverse Angstroms, by default 0\n\
 Return float.  Cannot be overloaded in Python.\n\
 ";
 
+const char* doc_ScatteringFactorTable_lookupId = "\
+Scattering factor of an atom type given by its integer ID at Q in 1/A.\n\
+\n\
+id   -- integer atom type ID from atomTypeId or siteTypeId\n\
+Q    -- Q value in inverse Angstroms, by default 0\n\
+\n\
+Return float.  Cannot be overloaded in Python.  The values for the last\n\
+used Q are cached in an array indexed by the type IDs until the table\n\
+changes its ticker.\n\
+";
+
+const char* doc_ScatteringFactorTable_lookupArray = "\
+Scattering factors for several atoms and an array of Q values.\n\
+\n\
+smbls    -- sequence of string symbols for atoms, ions or isotopes\n\
+            or their integer IDs from atomTypeId.  A single string\n\
+            is used as a one-item sequence.\n\
+q        -- array of Q values in inverse Angstroms.\n\
+out      -- optional C-contiguous float64 array for the result.\n\
+\n\
+Return an (len(smbls), len(q)) array of the scattering factors.\n\
+";
+
 const char* doc_ScatteringFactorTable__standardLookup = "\
 Standard value of the atom scattering factor at given Q in 1/A.\n\
 \n\
@@ -103,6 +135,15 @@ Raise ValueError for unknown atom symbol.\n\
 This method must be overloaded in a derived class.\n\
 ";
 
+const char* doc_ScatteringFactorTable__resetLookupCache = "\
+Discard the memoized results of the _standardLookup method.\n\
+\n\
+The values returned by a Python-defined _standardLookup are cached\n\
+for every symbol and Q.  This must be called when a change in the\n\
+derived class state affects the standard scattering factors.\n\
+Custom values from setCustomAs do not need this call.\n\
+";
+
 const char* doc_ScatteringFactorTable_setCustomAs2 = "\
 Define custom alias for the specified atom symbol.\n\
 Example: setCustomAs('12-C', 'C')  will declare the same\n\
@@ -221,11 +262,94 @@ DECLARE_PYSET_METHOD_WRAPPER(getCustomSymbols, getCustomSymbols_asset)
 DECLARE_PYSET_FUNCTION_WRAPPER(ScatteringFactorTable::getRegisteredTypes,
         getScatteringFactorTableTypes_asset)
 
+// lookup of the interned atom types
+
+typedef std::pair<diffpy::eventticker::EventTicker::value_type, double>
+    SFIdCacheStamp;
+typedef TypeIdCache<double, SFIdCacheStamp> SFIdCache;
+typedef boost::shared_ptr<SFIdCache> SFIdCachePtr;
+
+double lookupid(object self, int id, double q)
+{
+    const ScatteringFactorTable& obj =
+        extract<const ScatteringFactorTable&>(self);
+    SFIdCachePtr cache = getinstancecache<SFIdCache>(self, "_typeidcache");
+    cache->validate(SFIdCacheStamp(obj.ticker().value(), q));
+    const double* prv = cache->find(id);
+    if (prv)  return *prv;
+    return cache->insert(id, obj.lookup(internedSymbol(id), q));
+}
+
+// table mutators give private clones to the calculators that share
+// the table before writing
+
+void detachsftable(const ScatteringFactorTable& obj)
+{
+    SharedTableRegistry<ScatteringFactorTable>::instance().detach(obj);
+}
+
+
+void setcustomas2(ScatteringFactorTable& obj,
+        const std::string& smbl, const std::string& src)
+{
+    detachsftable(obj);
+    obj.setCustomAs(smbl, src);
+}
+
+
+void setcustomas4(ScatteringFactorTable& obj,
+        const std::string& smbl, const std::string& src, double sf, double q)
+{
+    detachsftable(obj);
+    obj.setCustomAs(smbl, src, sf, q);
+}
+
+
+void resetcustom(ScatteringFactorTable& obj, const std::string& smbl)
+{
+    detachsftable(obj);
+    obj.resetCustom(smbl);
+}
+
+
+void resetall(ScatteringFactorTable& obj)
+{
+    detachsftable(obj);
+    obj.resetAll();
+}
+
+// batch lookup of scattering factors
+
+object lookuparray(const ScatteringFactorTable& obj,
+        object smbls, object q, object out)
+{
+    std::vector<std::string> symbols;
+    extract<std::string> getsmbl(smbls);
+    if (getsmbl.check())  symbols.push_back(getsmbl());
+    stl_input_iterator<object> si(getsmbl.check() ? list() : smbls), send;
+    for (; si != send; ++si)
+    {
+        extract<std::string> smbl(*si);
+        symbols.push_back(smbl.check() ? smbl() :
+                internedSymbol(extractint(*si)));
+    }
+    QuantityType q0;
+    const QuantityType& qa = extractQuantityType(q, q0);
+    int sz[2] = {int(symbols.size()), int(qa.size())};
+    NumPyArray_DoublePtr rv = useNumPyDoubleArray(out, 2, sz);
+    if (!qa.empty())
+    {
+        lookupScatteringFactors(obj, symbols, &(qa[0]), qa.size(),
+                rv.second);
+    }
+    return rv.first;
+}
+
 // wrappers for the scatteringfactortable property
 
-ScatteringFactorTablePtr getsftable(ScatteringFactorTableOwner& obj)
+ScatteringFactorTablePtr getsftable(object owner)
 {
-    return obj.getScatteringFactorTable();
+    return getsharedtable<ScatteringFactorTable>(owner, sftableowneraccess());
 }
 
     DECLARE_BYTYPE_SETTER_WRAPPER(setScatteringFactorTable, setsftable)
@@ -244,9 +368,10 @@ class ScatteringFactorTableWrap :
 
         // Copy Constructor
 
-        ScatteringFactorTableWrap() { }
+        ScatteringFactorTableWrap() : mlookupcachesize(0)  { }
 
-        ScatteringFactorTableWrap(const ScatteringFactorTable& src)
+        ScatteringFactorTableWrap(const ScatteringFactorTable& src) :
+            mlookupcachesize(0)
         {
             ScatteringFactorTable& thistable = *this;
             thistable = src;
@@ -283,7 +408,28 @@ class ScatteringFactorTableWrap :
 
         double standardLookup(const std::string& smbl, double q) const
         {
-            return this->get_pure_virtual_override("_standardLookup")(smbl, q);
+            // Memoize the Python overload, which is usually called with
+            // the same Q-grid values for every pair of atoms.
+            if (mlookupcachesize >= MAXLOOKUPCACHESIZE ||
+                    mlookupticker != this->ticker().value())
+            {
+                this->resetLookupCache();
+                mlookupticker = this->ticker().value();
+            }
+            LookupCache::mapped_type& sfq = mlookupcache[smbl];
+            LookupCache::mapped_type::iterator ii = sfq.lower_bound(q);
+            if (ii != sfq.end() && ii->first == q)  return ii->second;
+            double rv =
+                this->get_pure_virtual_override("_standardLookup")(smbl, q);
+            sfq.insert(ii, std::make_pair(q, rv));
+            ++mlookupcachesize;
+            return rv;
+        }
+
+        void resetLookupCache() const
+        {
+            mlookupcache.clear();
+            mlookupcachesize = 0;
         }
 
     protected:
@@ -297,12 +443,30 @@ class ScatteringFactorTableWrap :
 
     private:
 
+        // types
+        typedef std::map<std::string, std::map<double, double> > LookupCache;
+
+        // constants
+        static const int MAXLOOKUPCACHESIZE = 1000000;
+
+        // data
         mutable std::string mtype;
         mutable std::string mradiationtype;
         wrapper_registry_configurator<ScatteringFactorTable> mconfigurator;
+        mutable LookupCache mlookupcache;
+        mutable int mlookupcachesize;
+        mutable diffpy::eventticker::EventTicker::value_type mlookupticker;
 
 };  // class ScatteringFactorTableWrap
 
+
+void resetlookupcache(ScatteringFactorTable& obj)
+{
+    ScatteringFactorTableWrap* pwrap =
+        dynamic_cast<ScatteringFactorTableWrap*>(&obj);
+    if (pwrap)  pwrap->resetLookupCache();
+}
+
 }   // namespace nswrap_ScatteringFactorTable
 
 // Wrapper definition --------------------------------------------------------
@@ -333,26 +497,30 @@ void wrap_ScatteringFactorTable()
                 &ScatteringFactorTable::lookup,
                 (bp::arg("smbl"), bp::arg("q")=0.0),
                 doc_ScatteringFactorTable_lookup)
+        .def("lookupArray", lookuparray,
+                (bp::arg("smbls"), bp::arg("q"), bp::arg("out")=object()),
+                doc_ScatteringFactorTable_lookupArray)
+        .def("lookupId", lookupid,
+                (bp::arg("id"), bp::arg("q")=0.0),
+                doc_ScatteringFactorTable_lookupId)
         .def("_standardLookup",
                 &ScatteringFactorTable::standardLookup,
                 (bp::arg("smbl"), bp::arg("q")),
                 doc_ScatteringFactorTable__standardLookup)
+        .def("_resetLookupCache", resetlookupcache,
+                doc_ScatteringFactorTable__resetLookupCache)
 
-        .def("setCustomAs", (void (ScatteringFactorTable::*)
-                (const std::string&, const std::string&))
-                &ScatteringFactorTable::setCustomAs,
+        .def("setCustomAs", setcustomas2,
                 (bp::arg("smbl"), bp::arg("src")),
                 doc_ScatteringFactorTable_setCustomAs2)
-        .def("setCustomAs", (void (ScatteringFactorTable::*)
-                (const std::string&, const std::string&, double, double))
-                &ScatteringFactorTable::setCustomAs,
+        .def("setCustomAs", setcustomas4,
                 (bp::arg("smbl"), bp::arg("src"),
                  bp::arg("sf"), bp::arg("q")=0.0),
                 doc_ScatteringFactorTable_setCustomAs4)
 
-        .def("resetCustom", &ScatteringFactorTable::resetCustom,
+        .def("resetCustom", resetcustom,
                 bp::arg("smbl"), doc_ScatteringFactorTable_resetCustom)
-        .def("resetAll", &ScatteringFactorTable::resetAll,
+        .def("resetAll", resetall,
                 doc_ScatteringFactorTable_resetAll)
         .def("getCustomSymbols", getCustomSymbols_asset<ScatteringFactorTable>,
                 doc_ScatteringFactorTable_getCustomSymbols)
@@ -369,6 +537,11 @@ void wrap_ScatteringFactorTable()
 
     register_ptr_to_python<ScatteringFactorTablePtr>();
 
+    // opaque storage for the scattering factors indexed by type IDs
+    class_<SFIdCache, SFIdCachePtr, noncopyable>("_SFIdCache")
+        .def_pickle(EmptyCachePickleSuite<SFIdCache>())
+        ;
+
     class_<SFTXray, bases<ScatteringFactorTable> >(
             "SFTXray", doc_SFTXray);
     class_<SFTElectron, bases<ScatteringFactorTable> >(
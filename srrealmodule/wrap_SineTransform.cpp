@@ -0,0 +1,207 @@
+/*****************************************************************************
+*
+* diffpy.srreal     by DANSE Diffraction group
+*                   Simon J. L. Billinge
+*                   (c) 2013 Trustees of the Columbia University
+*                   in the City of New York.  All rights reserved.
+*
+* File coded by:    Pavol Juhas
+*
+* See AUTHORS.txt for a list of people who contributed.
+* See LICENSE.txt for license information.
+*
+******************************************************************************
+*
+* Bindings to the SineTransform class for repeated and batched conversions
+* between F(Q) and G(r).
+*
+*****************************************************************************/
+
+#include <boost/python.hpp>
+#include <cmath>
+#include <stdexcept>
+
+#include "srreal_converters.hpp"
+#include "srreal_sinetransform.hpp"
+// numpy/arrayobject.h needs to be included after srreal_converters.hpp,
+// which defines PY_ARRAY_UNIQUE_SYMBOL.  NO_IMPORT_ARRAY indicates
+// import_array will be called in the extension module initializer.
+#define NO_IMPORT_ARRAY
+#include <numpy/arrayobject.h>
+
+namespace srrealmodule {
+namespace nswrap_SineTransform {
+
+using namespace boost::python;
+
+// docstrings ----------------------------------------------------------------
+
+const char* doc_SineTransform = "\
+Sine-fast Fourier transforms between F(Q) and G(r) with cached plans.\n\
+The transforms keep the FFT tables for every padded length, accept 2D\n\
+arrays with one dataset per row and can write to a preallocated output\n\
+array.  They release the GIL so they can run in parallel threads.\n\
+\n\
+By default the output rows are padded to the next power of 2 of the\n\
+input grid length including the qmin or rmin offset.  The fftftog and\n\
+fftgtof functions may pad to a different power of 2.  The output grid\n\
+always spans pi / step, so such results are samples of the same curve\n\
+at a different spacing.  With an equal npad argument the transforms\n\
+and the fftftog and fftgtof functions have the same output grid.\n\
+";
+
+const char* doc_SineTransform_ftog = "\
+Perform sine-fast Fourier transform from F(Q) to G(r).\n\
+The length of the output rows is padded to the next power of 2\n\
+unless specified by npad.\n\
+\n\
+f        -- array of the F values on a regular Q-space grid.\n\
+            A 2D array is transformed row by row.\n\
+qstep    -- spacing in the Q-space grid, this is used for proper\n\
+            scaling of the output array.\n\
+qmin     -- optional starting point of the Q-space grid.\n\
+npad     -- optional length of the output rows.  It must be at least\n\
+            qmin / qstep + len(f).  Any length is O(npad log npad),\n\
+            powers of 2 are fastest.  Use the next power of 2 when 0.\n\
+out      -- optional C-contiguous float64 array for the result.\n\
+            It must have the shape of the output array.\n\
+\n\
+Return a tuple of (g, rstep).  These can be used with the complementary\n\
+gtof method to recover the original signal f.\n\
+";
+
+const char* doc_SineTransform_gtof = "\
+Perform sine-fast Fourier transform from G(r) to F(Q).\n\
+The length of the output rows is padded to the next power of 2\n\
+unless specified by npad.\n\
+\n\
+g        -- array of the G values on a regular r-space grid.\n\
+            A 2D array is transformed row by row.\n\
+rstep    -- spacing in the r-space grid, this is used for proper\n\
+            scaling of the output array.\n\
+rmin     -- optional starting point of the r-space grid.\n\
+npad     -- optional length of the output rows.  It must be at least\n\
+            rmin / rstep + len(g).  Any length is O(npad log npad),\n\
+            powers of 2 are fastest.  Use the next power of 2 when 0.\n\
+out      -- optional C-contiguous float64 array for the result.\n\
+            It must have the shape of the output array.\n\
+\n\
+Return a tuple of (f, qstep).  These can be used with the complementary\n\
+ftog method to recover the original signal g.\n\
+";
+
+const char* doc_SineTransform_countPlans = "\
+Return the number of cached transform plans.\n\
+";
+
+const char* doc_SineTransform_clearPlans = "\
+Remove all cached transform plans.\n\
+";
+
+// wrappers ------------------------------------------------------------------
+
+// release the GIL in the scope of this object
+
+class GILRelease
+{
+    public:
+
+        GILRelease() : mstate(PyEval_SaveThread())  { }
+        ~GILRelease()  { PyEval_RestoreThread(mstate); }
+
+    private:
+
+        PyThreadState* mstate;
+
+};
+
+
+tuple applysinetransform(SineTransform& obj, object x, double step,
+        double xmin, int npad, object out, double scale)
+{
+    if (step <= 0)
+    {
+        const char* emsg = "Grid step must be positive.";
+        throw std::invalid_argument(emsg);
+    }
+    if (xmin < 0)
+    {
+        const char* emsg = "Grid start must be non-negative.";
+        throw std::invalid_argument(emsg);
+    }
+    PyObject* px = PyArray_ContiguousFromAny(x.ptr(), NPY_DOUBLE, 1, 2);
+    if (!px)  throw_error_already_set();
+    object xa((handle<>(px)));
+    const int ndim = PyArray_NDIM(px);
+    const int nrows = (2 == ndim) ? PyArray_DIM(px, 0) : 1;
+    const int nx = PyArray_DIM(px, ndim - 1);
+    const int offset = SineTransform::gridOffset(step, xmin);
+    const int padlen = (npad > 0) ? npad :
+        SineTransform::padLength(offset + nx);
+    if (padlen < offset + nx)
+    {
+        const char* emsg = "npad is smaller than the input grid.";
+        throw std::invalid_argument(emsg);
+    }
+    int sz[2] = {nrows, padlen};
+    int* szout = (2 == ndim) ? sz : (sz + 1);
+    NumPyArray_DoublePtr ya = useNumPyDoubleArray(out, ndim, szout);
+    double* py = ya.second;
+    const double* pxdata = static_cast<const double*>(PyArray_DATA(px));
+    if (padlen > 0)
+    {
+        SineTransform::PlanPtr plan = obj.getPlan(padlen);
+        GILRelease nogil;
+        SineTransformPlan::WorkBuffer work;
+        for (int i = 0; i < nrows; ++i)
+        {
+            plan->transform(pxdata + i * nx, nx, offset, scale * step,
+                    py + i * padlen, work);
+        }
+    }
+    double rvstep = (padlen > 0) ? (M_PI / (padlen * step)) : 0.0;
+    return make_tuple(ya.first, rvstep);
+}
+
+
+tuple sinetransform_ftog(SineTransform& obj, object f,
+        double qstep, double qmin, int npad, object out)
+{
+    return applysinetransform(obj, f, qstep, qmin, npad, out, 2 / M_PI);
+}
+
+
+tuple sinetransform_gtof(SineTransform& obj, object g,
+        double rstep, double rmin, int npad, object out)
+{
+    return applysinetransform(obj, g, rstep, rmin, npad, out, 1.0);
+}
+
+}   // namespace nswrap_SineTransform
+
+// Wrapper definition --------------------------------------------------------
+
+void wrap_SineTransform()
+{
+    using namespace nswrap_SineTransform;
+    namespace bp = boost::python;
+
+    class_<SineTransform>("SineTransform", doc_SineTransform)
+        .def("ftog", sinetransform_ftog,
+                (bp::arg("f"), bp::arg("qstep"), bp::arg("qmin")=0.0,
+                 bp::arg("npad")=0, bp::arg("out")=object()),
+                doc_SineTransform_ftog)
+        .def("gtof", sinetransform_gtof,
+                (bp::arg("g"), bp::arg("rstep"), bp::arg("rmin")=0.0,
+                 bp::arg("npad")=0, bp::arg("out")=object()),
+                doc_SineTransform_gtof)
+        .def("countPlans", &SineTransform::countPlans,
+                doc_SineTransform_countPlans)
+        .def("clearPlans", &SineTransform::clearPlans,
+                doc_SineTransform_clearPlans)
+        ;
+}
+
+}   // namespace srrealmodule
+
+// End of file
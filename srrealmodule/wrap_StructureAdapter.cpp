@@ -27,6 +27,8 @@
 
 #include "srreal_converters.hpp"
 #include "srreal_pickling.hpp"
+#include "srreal_symbols.hpp"
+#include "srreal_xyzloader.hpp"
 
 namespace srrealmodule {
 namespace nswrap_StructureAdapter {
@@ -76,6 +78,15 @@ i    -- zero-based atom site index.\n\
 Return a string symbol.\n\
 ";
 
+const char* doc_StructureAdapter_siteTypeId = "\
+Integer ID of the atom type at the specified site.  The IDs are unique\n\
+for every symbol and remain the same in the Python process.\n\
+\n\
+i    -- zero-based atom site index.\n\
+\n\
+Return integer ID.  Use atomTypeOfId to get back the symbol.\n\
+";
+
 const char* doc_StructureAdapter_siteCartesianPosition = "\
 Return absolute cartesian coordinates of the specified atom site.\n\
 \n\
@@ -128,6 +139,12 @@ No return value.  This method can be overloaded in the derived class.\n\
 No action by default.\n\
 ";
 
+const char* doc_XYZStructureAdapter = "\
+Non-periodic StructureAdapter with atom sites stored in C++ arrays.\n\
+The sites have isotropic displacement parameters and fractional\n\
+occupancies.  Use the loadXYZ function to create an instance.\n\
+";
+
 const char* doc_nometa = "\
 Return a proxy to StructureAdapter with _customPQConfig method disabled.\n\
 This creates a thin wrapper over a source StructureAdapter object that\n\
@@ -159,12 +176,45 @@ Return a StructureAdapter instance.\n\
 Raise TypeError if stru cannot be converted to StructureAdapter.\n\
 ";
 
+const char* doc_loadXYZ = "\
+Load XYZ or extended XYZ file to a non-periodic StructureAdapter.\n\
+The file is parsed in C++, which is much faster than a conversion of\n\
+diffpy.Structure for large structures.  Only the first frame is loaded.\n\
+\n\
+filename -- path to XYZ or extended XYZ file.  Plain XYZ lines start\n\
+            with element, x, y, z and any extra columns are ignored.\n\
+            Extended XYZ files must define species and pos in their\n\
+            Properties key and may have Uiso and occupancy columns.\n\
+            Sites have zero Uiso and unit occupancy when these columns\n\
+            are not defined.  The Lattice key is ignored.\n\
+\n\
+Return an XYZStructureAdapter with cartesian coordinates in Angstroms.\n\
+Raise ValueError for unreadable or invalid file.\n\
+";
+
 const char* doc__emptyStructureAdapter = "\
 Factory for an empty structure singleton.\n\
 \n\
 Return a singleton instance of empty StructureAdapter.\n\
 ";
 
+const char* doc_atomTypeId = "\
+Integer ID of an atom type symbol, which is added to the global table\n\
+of interned symbols when not yet present.\n\
+\n\
+smbl -- string symbol for atom, ion or isotope.\n\
+\n\
+Return integer ID.\n\
+";
+
+const char* doc_atomTypeOfId = "\
+Atom type symbol of an integer ID from atomTypeId or siteTypeId.\n\
+\n\
+id   -- integer ID of an interned atom type.\n\
+\n\
+Return string symbol.  Raise ValueError for an unknown ID.\n\
+";
+
 // wrappers ------------------------------------------------------------------
 
 DECLARE_PYARRAY_METHOD_WRAPPER1(siteCartesianPosition,
@@ -324,24 +374,53 @@ class StructureAdapterWrap :
 
 };  // class StructureAdapterWrap
 
+// wrappers for interned atom type symbols
+
+int siteTypeId(const StructureAdapter& adpt, int idx)
+{
+    return internSymbol(adpt.siteAtomType(idx));
+}
+
+
+std::string atomTypeOfId(int id)
+{
+    return internedSymbol(id);
+}
+
 // pickle support
 
 StructureAdapterPtr
 createStructureAdapterFromString(const std::string& content)
 {
     StructureAdapterPtr adpt;
-    diffpy::serialization_fromstring(adpt, content);
+    pickle_fromstring(adpt, content);
     return adpt;
 }
 
 
+XYZStructureAdapterPtr
+createXYZStructureAdapterFromString(const std::string& content)
+{
+    StructureAdapterPtr adpt;
+    pickle_fromstring(adpt, content);
+    XYZStructureAdapterPtr rv =
+        boost::dynamic_pointer_cast<XYZStructureAdapter>(adpt);
+    if (!rv)
+    {
+        const char* emsg = "Pickle content is not an XYZStructureAdapter.";
+        throw std::invalid_argument(emsg);
+    }
+    return rv;
+}
+
+
 class StructureAdapterPickleSuite : public pickle_suite
 {
     public:
 
         static python::tuple getinitargs(StructureAdapterPtr adpt)
         {
-            std::string content = diffpy::serialization_tostring(adpt);
+            std::string content = pickle_tostring(adpt);
             return python::make_tuple(content);
         }
 
@@ -375,6 +454,8 @@ void wrap_StructureAdapter()
                 &StructureAdapterWrap::default_siteAtomType,
                 return_value_policy<copy_const_reference>(),
                 doc_StructureAdapter_siteAtomType)
+        .def("siteTypeId", siteTypeId,
+                python::arg("i"), doc_StructureAdapter_siteTypeId)
         .def("siteCartesianPosition",
                     siteCartesianPosition_asarray<StructureAdapter,int>,
                     doc_StructureAdapter_siteCartesianPosition)
@@ -402,12 +483,24 @@ void wrap_StructureAdapter()
 
     register_ptr_to_python<StructureAdapterPtr>();
 
+    class_<XYZStructureAdapter, bases<StructureAdapter>, noncopyable>(
+            "XYZStructureAdapter", doc_XYZStructureAdapter, no_init)
+        .def("__init__",
+                make_constructor(createXYZStructureAdapterFromString),
+                doc_StructureAdapter___init__)
+        ;
+
+    register_ptr_to_python<XYZStructureAdapterPtr>();
+
     def("nometa", nometa<object>, doc_nometa);
     def("nosymmetry", nosymmetry<object>, doc_nosymmetry);
+    def("loadXYZ", loadXYZ, python::arg("filename"), doc_loadXYZ);
     def("createStructureAdapter", createStructureAdapter,
             doc_createStructureAdapter);
     def("_emptyStructureAdapter", emptyStructureAdapter,
             doc__emptyStructureAdapter);
+    def("atomTypeId", internSymbol, python::arg("smbl"), doc_atomTypeId);
+    def("atomTypeOfId", atomTypeOfId, python::arg("id"), doc_atomTypeOfId);
 }
 
 }   // namespace srrealmodule
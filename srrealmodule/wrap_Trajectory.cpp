@@ -0,0 +1,167 @@
+/*****************************************************************************
+*
+* diffpy.srreal     by DANSE Diffraction group
+*                   Simon J. L. Billinge
+*                   (c) 2013 Trustees of the Columbia University
+*                   in the City of New York.  All rights reserved.
+*
+* File coded by:    Pavol Juhas
+*
+* See AUTHORS.txt for a list of people who contributed.
+* See LICENSE.txt for license information.
+*
+******************************************************************************
+*
+* Bindings to the TrajectoryStructureAdapter class and the evalFrames
+* driver for averaging PairQuantity values over trajectory frames.
+*
+*****************************************************************************/
+
+#include <boost/python.hpp>
+#include <climits>
+
+#include "srreal_converters.hpp"
+#include "srreal_trajectory.hpp"
+
+namespace srrealmodule {
+namespace nswrap_Trajectory {
+
+using namespace boost::python;
+using namespace diffpy::srreal;
+
+// docstrings ----------------------------------------------------------------
+
+const char* doc_TrajectoryStructureAdapter = "\
+Non-periodic StructureAdapter for one frame of a binary trajectory file.\n\
+The file is memory mapped and selecting another frame only updates\n\
+the site positions.  The file layout is described in the\n\
+diffpy.srreal.trajectory module.\n\
+";
+
+const char* doc_TrajectoryStructureAdapter___init__ = "\
+Open a binary trajectory file.\n\
+\n\
+filename -- path to the trajectory file\n\
+frame    -- zero-based index of the initial frame\n\
+\n\
+Raise ValueError when the file cannot be opened and mapped or for\n\
+invalid file content or frame index.\n\
+";
+
+const char* doc_TrajectoryStructureAdapter_filename = "\
+Absolute path to the mapped trajectory file.\n\
+Pickles refer to the file by this path.\n\
+";
+
+const char* doc_TrajectoryStructureAdapter_countFrames = "\
+Return number of frames in the trajectory file.\n\
+";
+
+const char* doc_TrajectoryStructureAdapter_getFrame = "\
+Return zero-based index of the current frame.\n\
+";
+
+const char* doc_TrajectoryStructureAdapter_setFrame = "\
+Select the current frame of the trajectory.\n\
+\n\
+frame    -- zero-based frame index\n\
+\n\
+No return value.  Raise ValueError for frame out of range.\n\
+";
+
+const char* doc__evalFrames = "\
+Evaluate PairQuantity for a range of trajectory frames.\n\
+The pair sums of all frames are averaged in C++ and the value is\n\
+finished once from the mean sums.\n\
+\n\
+pq       -- PairQuantity object to be evaluated\n\
+traj     -- TrajectoryStructureAdapter, it is not changed\n\
+start    -- index of the first frame\n\
+stop     -- frame index where to stop, clipped to the frame count\n\
+stride   -- step between the evaluated frames\n\
+\n\
+Return numpy array of the averaged value.  The pq object keeps this\n\
+value and a copy of traj at the last evaluated frame, its derived\n\
+results such as PDFCalculator.pdf are thus frame averages as well.\n\
+Raise ValueError for an empty frame range or when the length of\n\
+the values changes between frames.\n\
+";
+
+// wrappers ------------------------------------------------------------------
+
+TrajectoryStructureAdapterPtr
+createTrajectoryAdapter(const std::string& filename, int frame)
+{
+    TrajectoryFilePtr trj(new TrajectoryFile(filename));
+    TrajectoryStructureAdapterPtr rv(
+            new TrajectoryStructureAdapter(trj, frame));
+    return rv;
+}
+
+
+std::string trajectoryfilename(const TrajectoryStructureAdapter& adpt)
+{
+    return adpt.getTrajectoryFile()->filename();
+}
+
+
+object evalframes(PairQuantity& pq, TrajectoryStructureAdapterPtr traj,
+        int start, int stop, int stride)
+{
+    QuantityType rv = evalFrames(pq, traj, start, stop, stride);
+    return convertToNumPyArray(rv);
+}
+
+// pickle support
+
+class TrajectoryPickleSuite : public pickle_suite
+{
+    public:
+
+        static boost::python::tuple
+            getinitargs(const TrajectoryStructureAdapter& adpt)
+        {
+            return boost::python::make_tuple(
+                    trajectoryfilename(adpt), adpt.getFrame());
+        }
+
+};  // class TrajectoryPickleSuite
+
+}   // namespace nswrap_Trajectory
+
+// Wrapper definition --------------------------------------------------------
+
+void wrap_Trajectory()
+{
+    using namespace nswrap_Trajectory;
+    using boost::noncopyable;
+
+    class_<TrajectoryStructureAdapter, bases<StructureAdapter>,
+        noncopyable>("TrajectoryStructureAdapter",
+                doc_TrajectoryStructureAdapter, no_init)
+        .def("__init__", make_constructor(createTrajectoryAdapter,
+                    default_call_policies(),
+                    (arg("filename"), arg("frame")=0)),
+                doc_TrajectoryStructureAdapter___init__)
+        .add_property("filename", trajectoryfilename,
+                doc_TrajectoryStructureAdapter_filename)
+        .def("countFrames", &TrajectoryStructureAdapter::countFrames,
+                doc_TrajectoryStructureAdapter_countFrames)
+        .def("getFrame", &TrajectoryStructureAdapter::getFrame,
+                doc_TrajectoryStructureAdapter_getFrame)
+        .def("setFrame", &TrajectoryStructureAdapter::setFrame,
+                arg("frame"), doc_TrajectoryStructureAdapter_setFrame)
+        .def_pickle(TrajectoryPickleSuite())
+        ;
+
+    register_ptr_to_python<TrajectoryStructureAdapterPtr>();
+
+    def("_evalFrames", evalframes,
+            (arg("pq"), arg("traj"), arg("start")=0,
+             arg("stop")=INT_MAX, arg("stride")=1),
+            doc__evalFrames);
+}
+
+}   // namespace srrealmodule
+
+// End of file